@@ -4,6 +4,11 @@
  Minimal implementation / docs.
  All register math follows the SC8812A datasheet register map and formulas.
  See datasheet register tables for formulas used here. (VBUSREF, IBUS/IBAT formulas, VINREG).
+
+ Writable registers (0x00..0x0C, 0x19) are mirrored in a shadow cache. A shadow
+ entry becomes valid after it has been read from or successfully written to the
+ chip; setters then modify the shadow and only touch the bus when the value
+ actually changes.
 */
 
 SC8812A::SC8812A(int8_t pstopPin)
@@ -16,6 +21,11 @@ SC8812A::SC8812A(int8_t pstopPin)
   _vbatRatio = 12.5f; // VBAT_MON_RATIO default 0 -> 12.5x
   _ibusRatio = 3.0f;  // default IBUS_RATIO = 10b -> 3x (per datasheet default)
   _ibatRatio = 12.0f; // default IBAT_RATIO = 1 -> 12x
+  _updateScales();
+
+  memset(_shadow, 0, sizeof(_shadow));
+  _shadowValid = 0;
+  _transactions = 0;
 }
 
 bool SC8812A::begin() {
@@ -32,51 +42,35 @@ bool SC8812A::begin(int sda, int scl) {
 void SC8812A::enableCharge() {
   enableADC(true);
   if (_pstopPin != -1) digitalWrite(_pstopPin, LOW);
-
-  uint8_t regVal = readRegister(SC8812A_REG_CTRL0_SET);
-  if (regVal == 0xFF) return;
-  regVal &= ~(1 << 7); // EN_OTG = 0 -> charging
-  writeRegister(SC8812A_REG_CTRL0_SET, regVal);
+  _updateRegister(SC8812A_REG_CTRL0_SET, (1 << 7), 0); // EN_OTG = 0 -> charging
 }
 
 void SC8812A::enableDischarge() {
   enableADC(true);
   if (_pstopPin != -1) digitalWrite(_pstopPin, LOW);
-
-  uint8_t regVal = readRegister(SC8812A_REG_CTRL0_SET);
-  if (regVal == 0xFF) return;
-  regVal |= (1 << 7); // EN_OTG = 1 -> discharging (OTG)
-  writeRegister(SC8812A_REG_CTRL0_SET, regVal);
+  _updateRegister(SC8812A_REG_CTRL0_SET, (1 << 7), (1 << 7)); // EN_OTG = 1 -> discharging (OTG)
 }
 
 void SC8812A::disablePower() {
   if (_pstopPin != -1) digitalWrite(_pstopPin, HIGH);
-  uint8_t regVal = readRegister(SC8812A_REG_CTRL0_SET);
-  if (regVal == 0xFF) return;
-  regVal &= ~(1 << 7); // ensure EN_OTG cleared
-  writeRegister(SC8812A_REG_CTRL0_SET, regVal);
+  _updateRegister(SC8812A_REG_CTRL0_SET, (1 << 7), 0); // ensure EN_OTG cleared
 }
 
 // --- configuration ---
 void SC8812A::setShuntResistors(float rs1_mOhm, float rs2_mOhm) {
   if (rs1_mOhm > 0.0f) _rs1_mOhm = rs1_mOhm;
   if (rs2_mOhm > 0.0f) _rs2_mOhm = rs2_mOhm;
+  _updateScales();
 }
 
 void SC8812A::setCellCount(uint8_t count) {
-  uint8_t regVal = readRegister(SC8812A_REG_VBAT_SET);
-  if (regVal == 0xFF) return;
-  regVal &= ~(0b11 << 3); // CSEL bits at [4:3]
-  regVal |= ((count & 0b11) << 3); 
-  writeRegister(SC8812A_REG_VBAT_SET, regVal);
+  // CSEL bits at [4:3]
+  _updateRegister(SC8812A_REG_VBAT_SET, (0b11 << 3), (uint8_t)((count & 0b11) << 3));
 }
 
 void SC8812A::setCellVoltage(uint8_t voltage) {
-  uint8_t regVal = readRegister(SC8812A_REG_VBAT_SET);
-  if (regVal == 0xFF) return;
-  regVal &= ~0b111; // VCELL_SET bits [2:0]
-  regVal |= (voltage & 0b111);
-  writeRegister(SC8812A_REG_VBAT_SET, regVal);
+  // VCELL_SET bits [2:0]
+  _updateRegister(SC8812A_REG_VBAT_SET, 0b111, (uint8_t)(voltage & 0b111));
 }
 
 void SC8812A::setIBUSCurrentLimit(float amps) {
@@ -89,7 +83,7 @@ void SC8812A::setIBUSCurrentLimit(float amps) {
   float denom_mOhm = (_ibusRatio * 10.0f); // IBUS_RATIO * 10 mΩ
   float setf = (amps * 256.0f * _rs1_mOhm) / denom_mOhm - 1.0f;
   int val = (int)round(constrain(setf, 0.0f, 255.0f));
-  writeRegister(SC8812A_REG_IBUS_LIM_SET, (uint8_t)val);
+  _updateRegister(SC8812A_REG_IBUS_LIM_SET, 0xFF, (uint8_t)val);
 }
 
 void SC8812A::setIBATCurrentLimit(float amps) {
@@ -102,24 +96,25 @@ void SC8812A::setIBATCurrentLimit(float amps) {
   float denom_mOhm = (_ibatRatio * 10.0f); // IBAT_RATIO * 10 mΩ
   float setf = (amps * 256.0f * _rs2_mOhm) / denom_mOhm - 1.0f;
   int val = (int)round(constrain(setf, 0.0f, 255.0f));
-  writeRegister(SC8812A_REG_IBAT_LIM_SET, (uint8_t)val);
+  _updateRegister(SC8812A_REG_IBAT_LIM_SET, 0xFF, (uint8_t)val);
 }
 
 void SC8812A::setMinVBUSVoltage(float voltage) {
+  setMinVBUSMillivolts((uint16_t)constrain((long)round(voltage * 1000.0f), 0L, 65535L));
+}
+
+void SC8812A::setMinVBUSMillivolts(uint16_t millivolts) {
   // VINREG selection: choose ratio 40x when VINREG target < 10.24V per datasheet
-  bool ratio_bit = (voltage <= 10.24f);
-  float ratio_val = ratio_bit ? 40.0f : 100.0f; // factor (mV multiplier)
-  uint8_t ctrl0 = readRegister(SC8812A_REG_CTRL0_SET);
-  if (ctrl0 == 0xFF) return;
-  if (ratio_bit) ctrl0 |= (1 << 4); // VINREG_RATIO bit 4
-  else ctrl0 &= ~(1 << 4);
-  writeRegister(SC8812A_REG_CTRL0_SET, ctrl0);
+  bool ratio_bit = (millivolts <= 10240);
+  uint16_t ratio_val = ratio_bit ? 40 : 100; // factor (mV multiplier)
+  // VINREG_RATIO bit 4
+  if (!_updateRegister(SC8812A_REG_CTRL0_SET, (1 << 4), ratio_bit ? (1 << 4) : 0)) return;
 
   // VINREG formula per datasheet:
   // VINREG = (VINREG_SET + 1) × VINREG_RATIO (mV)
-  float reg_val = ((voltage * 1000.0f) / ratio_val) - 1.0f;
-  uint8_t set = (uint8_t)constrain((int)round(reg_val), 0, 255);
-  writeRegister(SC8812A_REG_VINREG_SET, set);
+  int32_t reg_val = (int32_t)((millivolts + ratio_val / 2) / ratio_val) - 1;
+  uint8_t set = (uint8_t)constrain(reg_val, 0, 255);
+  _updateRegister(SC8812A_REG_VINREG_SET, 0xFF, set);
 }
 
 void SC8812A::setVBUSVoltage(float voltage) {
@@ -133,30 +128,18 @@ void SC8812A::setVBUSVoltage(float voltage) {
   uint8_t msb = (uint8_t)(raw_10bit >> 2); // highest 8 bits
   uint8_t lsb2 = (uint8_t)(raw_10bit & 0x03); // lowest 2 bits
 
-  writeRegister(SC8812A_REG_VBUSREF_I_SET, msb);
-
-  uint8_t reg02 = readRegister(SC8812A_REG_VBUSREF_I_SET2);
-  if (reg02 == 0xFF) return;
-  reg02 &= ~(0b11 << 6); // VBUSREF_I_SET2 bits [7:6]
-  reg02 |= (lsb2 << 6);
-  writeRegister(SC8812A_REG_VBUSREF_I_SET2, reg02);
+  _updateRegister(SC8812A_REG_VBUSREF_I_SET, 0xFF, msb);
+  _updateRegister(SC8812A_REG_VBUSREF_I_SET2, (0b11 << 6), (uint8_t)(lsb2 << 6)); // VBUSREF_I_SET2 bits [7:6]
 }
 
 void SC8812A::enableCurrentFoldback(bool enabled) {
-  uint8_t reg = readRegister(SC8812A_REG_CTRL3);
-  if (reg == 0xFF) return;
   // Datasheet: DIS_ShortFoldBack bit (bit2) -> 0 = foldback enabled, 1 = disable foldback
-  if (enabled) reg &= ~(1 << 2);
-  else reg |= (1 << 2);
-  writeRegister(SC8812A_REG_CTRL3, reg);
+  _updateRegister(SC8812A_REG_CTRL3, (1 << 2), enabled ? 0 : (1 << 2));
 }
 
 void SC8812A::enablePFMMode(bool enabled) {
-  uint8_t reg = readRegister(SC8812A_REG_CTRL3);
-  if (reg == 0xFF) return;
-  if (enabled) reg |= (1 << 0); // EN_PFM is bit0 per datasheet
-  else reg &= ~(1 << 0);
-  writeRegister(SC8812A_REG_CTRL3, reg);
+  // EN_PFM is bit0 per datasheet
+  _updateRegister(SC8812A_REG_CTRL3, (1 << 0), enabled ? (1 << 0) : 0);
 }
 
 void SC8812A::setSwitchingFrequency(uint8_t freq) {
@@ -165,62 +148,111 @@ void SC8812A::setSwitchingFrequency(uint8_t freq) {
   if (freq == 0) bits = 0b00;
   else if (freq == 1) bits = 0b01;
   else bits = 0b11;
-  uint8_t reg = readRegister(SC8812A_REG_CTRL0_SET);
-  if (reg == 0xFF) return;
-  reg &= ~(0b11 << 2); // FREQ_SET bits [3:2]
-  reg |= (bits << 2);
-  writeRegister(SC8812A_REG_CTRL0_SET, reg);
+  _updateRegister(SC8812A_REG_CTRL0_SET, (0b11 << 2), (uint8_t)(bits << 2)); // FREQ_SET bits [3:2]
 }
 
 void SC8812A::setDeadTime(uint8_t time) {
-  uint8_t reg = readRegister(SC8812A_REG_CTRL0_SET);
-  if (reg == 0xFF) return;
-  reg &= ~0b11; // DT_SET bits [1:0]
-  reg |= (time & 0b11);
-  writeRegister(SC8812A_REG_CTRL0_SET, reg);
+  _updateRegister(SC8812A_REG_CTRL0_SET, 0b11, (uint8_t)(time & 0b11)); // DT_SET bits [1:0]
 }
 
 // --- ADC & telemetry ---
 bool SC8812A::enableADC(bool enabled) {
-  uint8_t reg = readRegister(SC8812A_REG_CTRL3);
-  if (reg == 0xFF) return false;
   // AD_START is bit 5 per datasheet (1=start ADC)
-  if (enabled) reg |= (1 << 5);
-  else reg &= ~(1 << 5);
-  writeRegister(SC8812A_REG_CTRL3, reg);
-  return true;
+  return _updateRegister(SC8812A_REG_CTRL3, (1 << 5), enabled ? (1 << 5) : 0);
 }
 
 float SC8812A::getVbusVoltage() {
-  uint16_t raw = _readRawADC(SC8812A_REG_VBUS_FB);
-  // Datasheet: VBUS = (4*VBUS_FB_VALUE + VBUS_FB_VALUE2 + 1) x VBUS_RATIO x 2 mV
-  return (float)(raw + 1) * _vbusRatio * 0.002f;
+  return getVbusMillivolts() * 0.001f;
 }
 
 float SC8812A::getVbatVoltage() {
-  uint16_t raw = _readRawADC(SC8812A_REG_VBAT_FB);
-  // Datasheet: VBAT = (4 x VBAT_FB_VALUE + VBAT_FB_VALUE2 + 1) x VBAT_MON_RATIO x 2 mV
-  return (float)(raw + 1) * _vbatRatio * 0.002f;
+  return getVbatMillivolts() * 0.001f;
 }
 
 float SC8812A::getIbusCurrent() {
-  uint16_t raw = _readRawADC(SC8812A_REG_IBUS_VAL);
-  // Datasheet: IBUS (A) = (raw+1) * 2 / 1200 * IBUS_RATIO * 10mΩ / RS1
-  float ibus = ((float)(raw + 1) * 2.0f / 1200.0f) * _ibusRatio * (10.0f / _rs1_mOhm);
-  return ibus;
+  return getIbusMilliamps() * 0.001f;
 }
 
 float SC8812A::getIbatCurrent() {
-  uint16_t raw = _readRawADC(SC8812A_REG_IBAT_VAL);
-  // Datasheet: IBAT (A) = (raw+1) * 2 / 1200 * IBAT_RATIO * 10mΩ / RS2
-  float ibat = ((float)(raw + 1) * 2.0f / 1200.0f) * _ibatRatio * (10.0f / _rs2_mOhm);
-  return ibat;
+  return getIbatMilliamps() * 0.001f;
+}
+
+uint32_t SC8812A::getVbusMillivolts() {
+  return _scaleRaw(_readRawADC(SC8812A_REG_VBUS_FB), _vbusLsbQ16);
+}
+
+uint32_t SC8812A::getVbatMillivolts() {
+  return _scaleRaw(_readRawADC(SC8812A_REG_VBAT_FB), _vbatLsbQ16);
+}
+
+uint32_t SC8812A::getIbusMilliamps() {
+  return _scaleRaw(_readRawADC(SC8812A_REG_IBUS_VAL), _ibusLsbQ16);
+}
+
+uint32_t SC8812A::getIbatMilliamps() {
+  return _scaleRaw(_readRawADC(SC8812A_REG_IBAT_VAL), _ibatLsbQ16);
 }
 
 uint8_t SC8812A::getStatus() {
   return readRegister(SC8812A_REG_STATUS);
 }
 
+bool SC8812A::readTelemetry(Telemetry& t) {
+  // 0x0D..0x14 hold the four ADC channels as MSB/LSB pairs, STATUS follows at 0x17
+  uint8_t buf[SC8812A_REG_STATUS - SC8812A_REG_VBUS_FB + 1];
+  if (!_readBurst(SC8812A_REG_VBUS_FB, buf, sizeof(buf))) return false;
+
+  t.vbus_mV = _scaleRaw(_raw10(buf[0], buf[1]), _vbusLsbQ16);
+  t.vbat_mV = _scaleRaw(_raw10(buf[2], buf[3]), _vbatLsbQ16);
+  t.ibus_mA = _scaleRaw(_raw10(buf[4], buf[5]), _ibusLsbQ16);
+  t.ibat_mA = _scaleRaw(_raw10(buf[6], buf[7]), _ibatLsbQ16);
+  t.status = buf[SC8812A_REG_STATUS - SC8812A_REG_VBUS_FB];
+  return true;
+}
+
+// --- shadow cache ---
+bool SC8812A::resync() {
+  _shadowValid = 0;
+
+  // 0x00..0x0C are contiguous, fetch them in one auto-increment read
+  uint8_t buf[SC8812A_SHADOW_CTRL_COUNT];
+  if (!_readBurst(SC8812A_REG_VBAT_SET, buf, sizeof(buf))) return false;
+  for (uint8_t i = 0; i < SC8812A_SHADOW_CTRL_COUNT; i++) {
+    _shadow[i] = buf[i];
+    _shadowValid |= (1 << i);
+  }
+
+  uint8_t mask;
+  if (!_readBurst(SC8812A_REG_MASK, &mask, 1)) return false;
+  _shadow[_shadowIndex(SC8812A_REG_MASK)] = mask;
+  _shadowValid |= (1 << _shadowIndex(SC8812A_REG_MASK));
+  return true;
+}
+
+bool SC8812A::verify() {
+  uint8_t buf[SC8812A_SHADOW_CTRL_COUNT + 1];
+  if (!_readBurst(SC8812A_REG_VBAT_SET, buf, SC8812A_SHADOW_CTRL_COUNT)) return false;
+  if (!_readBurst(SC8812A_REG_MASK, &buf[SC8812A_SHADOW_CTRL_COUNT], 1)) return false;
+
+  // compare only what we believe we know; any mismatch adopts the chip's value
+  // so the next setter call writes the intended value again
+  bool match = true;
+  for (uint8_t i = 0; i < SC8812A_SHADOW_SIZE; i++) {
+    if ((_shadowValid & (1 << i)) && _shadow[i] != buf[i]) match = false;
+    _shadow[i] = buf[i];
+  }
+  _shadowValid = (1 << SC8812A_SHADOW_SIZE) - 1;
+  return match;
+}
+
+void SC8812A::invalidateCache() {
+  _shadowValid = 0;
+}
+
+uint32_t SC8812A::getTransactionCount() const {
+  return _transactions;
+}
+
 // --- private utilities ---
 bool SC8812A::_initialize() {
   if (_pstopPin != -1) {
@@ -232,54 +264,107 @@ bool SC8812A::_initialize() {
   Wire.beginTransmission(SC8812A_I2C_ADDR);
   if (Wire.endTransmission() != 0) return false;
 
+  // prime the shadow cache so the configuration below is write-only
+  if (!resync()) return false;
+
   // set FACTORY bit (datasheet recommends MCU write this bit to 1 after power up)
-  uint8_t ctrl2 = readRegister(SC8812A_REG_CTRL2_SET);
-  if (ctrl2 == 0xFF) return false;
-  ctrl2 |= (1 << 3); // FACTORY bit is bit3
-  writeRegister(SC8812A_REG_CTRL2_SET, ctrl2);
+  return _updateRegister(SC8812A_REG_CTRL2_SET, (1 << 3), (1 << 3)); // FACTORY bit is bit3
+}
 
-  return true;
+int8_t SC8812A::_shadowIndex(uint8_t addr) {
+  if (addr < SC8812A_SHADOW_CTRL_COUNT) return addr;
+  if (addr == SC8812A_REG_MASK) return SC8812A_SHADOW_CTRL_COUNT;
+  return -1;
+}
+
+bool SC8812A::_updateRegister(uint8_t addr, uint8_t mask, uint8_t bits) {
+  int8_t idx = _shadowIndex(addr);
+  if (idx < 0) return false;
+
+  if (!(_shadowValid & (1 << idx))) {
+    uint8_t reg = readRegister(addr);
+    if (reg == 0xFF) return false;
+    _shadow[idx] = reg;
+    _shadowValid |= (1 << idx);
+  }
+
+  uint8_t val = (_shadow[idx] & ~mask) | (bits & mask);
+  if (val == _shadow[idx]) return true; // already there, skip the bus
+  return writeRegister(addr, val);
 }
 
 uint8_t SC8812A::readRegister(uint8_t addr) {
-  Wire.beginTransmission(SC8812A_I2C_ADDR);
-  Wire.write(addr);
-  if (Wire.endTransmission() != 0) return 0xFF;
+  uint8_t val;
+  if (!_readBurst(addr, &val, 1)) return 0xFF;
 
-  // request one byte; Wire.requestFrom returns the number of bytes received
-  uint32_t t0 = millis();
-  Wire.requestFrom((uint8_t)SC8812A_I2C_ADDR, (uint8_t)1);
-  while (Wire.available() == 0) {
-    if ((millis() - t0) > 5) return 0xFF; // short timeout
+  int8_t idx = _shadowIndex(addr);
+  if (idx >= 0) {
+    _shadow[idx] = val;
+    _shadowValid |= (1 << idx);
   }
-  return Wire.read();
+  return val;
 }
 
 bool SC8812A::writeRegister(uint8_t addr, uint8_t val) {
+  _transactions++;
   Wire.beginTransmission(SC8812A_I2C_ADDR);
   Wire.write(addr);
   Wire.write(val);
-  return (Wire.endTransmission() == 0);
+  bool ok = (Wire.endTransmission() == 0);
+
+  int8_t idx = _shadowIndex(addr);
+  if (idx >= 0) {
+    // on failure we no longer know what the chip holds
+    if (ok) {
+      _shadow[idx] = val;
+      _shadowValid |= (1 << idx);
+    } else {
+      _shadowValid &= ~(1 << idx);
+    }
+  }
+  return ok;
+}
+
+bool SC8812A::_readBurst(uint8_t addr, uint8_t* buf, uint8_t len) {
+  _transactions++;
+  Wire.beginTransmission(SC8812A_I2C_ADDR);
+  Wire.write(addr);
+  if (Wire.endTransmission() != 0) return false;
+
+  // request len bytes; Wire.requestFrom returns once the transfer is over,
+  // with the number of bytes received
+  if (Wire.requestFrom((uint8_t)SC8812A_I2C_ADDR, len) != len) return false;
+  for (uint8_t i = 0; i < len; i++) buf[i] = Wire.read();
+  return true;
 }
 
 uint16_t SC8812A::_readRawADC(uint8_t msbAddr) {
   // read MSB register and the following LSB register (msbAddr and msbAddr+1)
-  Wire.beginTransmission(SC8812A_I2C_ADDR);
-  Wire.write(msbAddr);
-  if (Wire.endTransmission() != 0) return 0; // I2C error
-
-  // request two bytes
-  uint32_t t0 = millis();
-  Wire.requestFrom((uint8_t)SC8812A_I2C_ADDR, (uint8_t)2);
-  while (Wire.available() < 2) {
-    if ((millis() - t0) > 5) {
-      // timeout, return 0 as safe fallback
-      return 0;
-    }
-  }
-  uint8_t msb = Wire.read(); // highest 8 bits
-  uint8_t lsb = Wire.read(); // contains lowest 2 bits in its [7:6]
+  uint8_t buf[2];
+  if (!_readBurst(msbAddr, buf, 2)) return 0; // I2C error or timeout, 0 as safe fallback
+
+  return _raw10(buf[0], buf[1]);
+}
+
+uint16_t SC8812A::_raw10(uint8_t msb, uint8_t lsb) {
+  // msb holds the highest 8 bits, lsb contains the lowest 2 bits in its [7:6]
   // assemble 10-bit value: (MSB << 2) | (LSB >> 6)
-  uint16_t raw10 = ((uint16_t)msb << 2) | ((lsb >> 6) & 0x03);
-  return raw10;
-}
\ No newline at end of file
+  return ((uint16_t)msb << 2) | ((lsb >> 6) & 0x03);
+}
+
+uint32_t SC8812A::_scaleRaw(uint16_t raw, uint32_t lsbQ16) {
+  // every channel reads (raw + 1) LSBs, round to the nearest mV / mA
+  return (uint32_t)(((uint64_t)(raw + 1) * lsbQ16 + 0x8000) >> 16);
+}
+
+void SC8812A::_updateScales() {
+  // only runs when ratios or shunts change, so float is fine here
+  // Datasheet: VBUS = (4*VBUS_FB_VALUE + VBUS_FB_VALUE2 + 1) x VBUS_RATIO x 2 mV
+  _vbusLsbQ16 = (uint32_t)(_vbusRatio * 2.0f * 65536.0f + 0.5f);
+  // Datasheet: VBAT = (4 x VBAT_FB_VALUE + VBAT_FB_VALUE2 + 1) x VBAT_MON_RATIO x 2 mV
+  _vbatLsbQ16 = (uint32_t)(_vbatRatio * 2.0f * 65536.0f + 0.5f);
+  // Datasheet: IBUS (A) = (raw+1) * 2 / 1200 * IBUS_RATIO * 10mΩ / RS1
+  _ibusLsbQ16 = (uint32_t)((2000.0f / 1200.0f) * _ibusRatio * (10.0f / _rs1_mOhm) * 65536.0f + 0.5f);
+  // Datasheet: IBAT (A) = (raw+1) * 2 / 1200 * IBAT_RATIO * 10mΩ / RS2
+  _ibatLsbQ16 = (uint32_t)((2000.0f / 1200.0f) * _ibatRatio * (10.0f / _rs2_mOhm) * 65536.0f + 0.5f);
+}
@@ -29,8 +29,23 @@
 #define SC8812A_REG_STATUS          0x17
 #define SC8812A_REG_MASK            0x19
 
+// Shadow cache layout: 0x00..0x0C followed by 0x19
+#define SC8812A_SHADOW_CTRL_COUNT   13
+#define SC8812A_SHADOW_SIZE         (SC8812A_SHADOW_CTRL_COUNT + 1)
+
 class SC8812A {
 public:
+  /**
+   * @brief One coherent ADC snapshot, see readTelemetry().
+   */
+  struct Telemetry {
+    uint32_t vbus_mV;
+    uint32_t ibus_mA;
+    uint32_t vbat_mV;
+    uint32_t ibat_mA;
+    uint8_t status; // STATUS register (0x17)
+  };
+
   /**
    * @brief Constructor.
    * @param pstopPin The pin connected to the PSTOP input. -1 if not used.
@@ -103,6 +118,12 @@ public:
    */
   void setMinVBUSVoltage(float voltage); // V (VINREG)
 
+  /**
+   * @brief Integer variant of setMinVBUSVoltage().
+   * @param millivolts The minimum voltage in mV.
+   */
+  void setMinVBUSMillivolts(uint16_t millivolts); // mV (VINREG)
+
   /**
    * @brief Set the target VBUS output voltage (for discharge/OTG mode).
    * @param voltage The target output voltage in Volts.
@@ -164,17 +185,62 @@ public:
    */
   float getIbatCurrent(); // A
 
+  /**
+   * @brief Integer variants of the ADC getters above (no floating point).
+   */
+  uint32_t getVbusMillivolts(); // mV
+  uint32_t getVbatMillivolts(); // mV
+  uint32_t getIbusMilliamps();  // mA
+  uint32_t getIbatMilliamps();  // mA
+
   /**
    * @brief Read the main status register (0x17).
    * @return The 8-bit status register.
    */
   uint8_t getStatus();
 
+  /**
+   * @brief Read VBUS, IBUS, VBAT, IBAT and STATUS in a single I2C transaction.
+   * @param t Snapshot to fill; left untouched on failure.
+   * @return true on success.
+   */
+  bool readTelemetry(Telemetry& t);
+
+  // register shadow cache
+  /**
+   * @brief Reload the shadow copy of all writable registers from the chip.
+   *        Call after PSTOP toggling or a brown-out may have reset the chip.
+   * @return true if every register was read successfully.
+   */
+  bool resync();
+
+  /**
+   * @brief Compare the shadow copy against the chip and adopt the chip's values.
+   * @return true if the chip still holds what the shadow expects.
+   */
+  bool verify();
+
+  /**
+   * @brief Forget all cached register values; the next setter re-reads them.
+   */
+  void invalidateCache();
+
+  /**
+   * @brief Number of I2C transactions issued since construction.
+   */
+  uint32_t getTransactionCount() const;
+
 private:
   bool _initialize();
   uint8_t readRegister(uint8_t regAddr);
   bool writeRegister(uint8_t regAddr, uint8_t value);
+  bool _updateRegister(uint8_t regAddr, uint8_t mask, uint8_t bits); // write-through, skips unchanged
+  bool _readBurst(uint8_t regAddr, uint8_t* buf, uint8_t len);
   uint16_t _readRawADC(uint8_t msbAddr); // returns 10-bit raw (0..1023)
+  static uint16_t _raw10(uint8_t msb, uint8_t lsb);
+  static uint32_t _scaleRaw(uint16_t raw, uint32_t lsbQ16);
+  void _updateScales();
+  static int8_t _shadowIndex(uint8_t regAddr); // -1 if not a cached register
 
   int8_t _pstopPin;
 
@@ -185,6 +251,17 @@ private:
   float _vbatRatio; // 12.5 or 5.0
   float _ibusRatio; // 3 or 6
   float _ibatRatio; // 6 or 12
+
+  // ADC LSB weights in Q16.16, derived from the values above
+  uint32_t _vbusLsbQ16; // mV per LSB
+  uint32_t _vbatLsbQ16; // mV per LSB
+  uint32_t _ibusLsbQ16; // mA per LSB
+  uint32_t _ibatLsbQ16; // mA per LSB
+
+  // shadow cache
+  uint8_t _shadow[SC8812A_SHADOW_SIZE];
+  uint16_t _shadowValid; // bit n set -> _shadow[n] mirrors the chip
+  uint32_t _transactions;
 };
 
 #endif // SC8812A_H
\ No newline at end of file
@@ -0,0 +1,144 @@
+// Cycle-count comparison of the per-tick telemetry math, float vs fixed point,
+// and of formatting one status frame's values. Build with -D FIXEDPOINT_BENCH (see platformio.ini); results print on Serial at boot.
+#ifdef FIXEDPOINT_BENCH
+
+#include "bench.h"
+#include "system.h"
+#include "format.h"
+
+const int BENCH_TICKS = 1000;
+
+// inputs are volatile so the compiler cannot fold the work away
+volatile uint16_t benchBusRaw = 0x7D00;   // ~16 V
+volatile int16_t benchShuntRaw = -1234;   // ~-2.5 A
+volatile uint16_t benchVbusRaw = 480;     // ~12 V
+volatile uint16_t benchIbusRaw = 150;     // ~1.5 A
+volatile int32_t benchTempRaw = 45 * 128; // 45 C
+
+volatile int32_t benchSinkI;
+volatile float benchSinkF;
+
+// the pre fixed-point tick: library float conversions, float SOC, float fan curve
+static long calcPWMFloat(float temp, float minT, float maxT, int minP) {
+    if (temp < minT) return 0;
+    if (temp >= maxT) return 100;
+    return map((long)(temp * 100), (long)(minT * 100), (long)(maxT * 100), (long)minP, 100L);
+}
+
+static void floatTick() {
+    float vbat = (benchBusRaw >> 3) * 4 * 0.001f;
+    float ibat = benchShuntRaw * (30.0f / 32768.0f);
+    if (ibat > -0.002 && ibat < 0.002) ibat = 0;
+    float pbat = vbat * ibat;
+    float vbus = (float)(benchVbusRaw + 1) * 12.5f * 0.002f;
+    float ibus = ((float)(benchIbusRaw + 1) * 2.0f / 1200.0f) * 3.0f * (10.0f / 5.0f);
+    float pbus = vbus * ibus;
+    float vcel = vbat / 4.0;
+
+    float temps[4];
+    for (int i = 0; i < 4; i++) temps[i] = benchTempRaw * 0.0078125f;
+
+    float soc;
+    float v_comp = vbat + (ibat * -(cal_sag_comp / 10));
+    if (v_comp >= cal_max_soc_vcel * 4) soc = 100.0;
+    else if (v_comp <= cal_min_soc_vcel * 4) soc = 0.0;
+    else soc = ((v_comp - (cal_min_soc_vcel * 4)) / ((cal_max_soc_vcel * 4) - (cal_min_soc_vcel * 4))) * 100.0;
+
+    long pwm = max(calcPWMFloat(temps[0], tbat_min, tbat_max, fan_min_pwm),
+                   max(calcPWMFloat(max(temps[1], temps[2]), tmod_min, tmod_max, fan_min_pwm),
+                       calcPWMFloat(temps[3], tinv_min, tinv_max, fan_min_pwm)));
+    float fan = (pwm > 0) ? constrain(((float)pwm - (float)fan_min_pwm) / (100.0f - fan_min_pwm), 0.01f, 1.0f) : 0.0f;
+
+    float thresh = apo_curr_thres / 1000.0;
+    bool active = (ibat > 0.1 || abs(ibat) > thresh);
+
+    benchSinkF = pbat + pbus + vcel + soc + fan + (active ? 1 : 0);
+}
+
+static void fixedTick() {
+    int32_t vbat = (int32_t)(benchBusRaw >> 3) * 4;
+    int32_t ibat = (int32_t)benchShuntRaw * 10 / INA219_SHUNT_MOHM;
+    if (ibat >= -2 && ibat <= 2) ibat = 0;
+    int32_t pbat = vbat * ibat / 1000;
+    int32_t vbus = (int32_t)(((uint64_t)(benchVbusRaw + 1) * (25 << 16) + 0x8000) >> 16);
+    int32_t ibus = (int32_t)(((uint64_t)(benchIbusRaw + 1) * (10 << 16) + 0x8000) >> 16);
+    int32_t pbus = vbus * ibus / 1000;
+    int32_t vcel = vbat / 4;
+
+    int16_t temps[4];
+    for (int i = 0; i < 4; i++) temps[i] = (int16_t)(benchTempRaw * 100 / 128);
+
+    int32_t soc = calcSocPermille(vbat, ibat, toMilli(cal_sag_comp) / 10,
+                                  toMilli(cal_min_soc_vcel) * 4, toMilli(cal_max_soc_vcel) * 4);
+
+    long pwm = max(calcPWM(temps[0], toCenti(tbat_min), toCenti(tbat_max), fan_min_pwm),
+                   max(calcPWM(max(temps[1], temps[2]), toCenti(tmod_min), toCenti(tmod_max), fan_min_pwm),
+                       calcPWM(temps[3], toCenti(tinv_min), toCenti(tinv_max), fan_min_pwm)));
+    int fan = calcFanPercent(pwm, fan_min_pwm);
+
+    bool active = (ibat > 100 || abs(ibat) > apo_curr_thres);
+
+    benchSinkI = pbat + pbus + vcel + soc + fan + (active ? 1 : 0);
+}
+
+// one status frame: five panel values, two menu settings and an IP address
+volatile int32_t benchVbatMv = 15873, benchIbatMa = -2468, benchPbatMw = 39176, benchVcelMv = 3968;
+volatile int32_t benchSocPermille = 734;
+volatile float benchSetting = 12.3f;
+
+static void formatLegacy() {
+    char buf[20];
+    sprintf(buf, "%.2fV", fromMilli(benchVbatMv));
+    sprintf(buf, "%.2fA", fromMilli(benchIbatMa));
+    sprintf(buf, "%.0fW", fromMilli(benchPbatMw));
+    sprintf(buf, "%.2fV", fromMilli(benchVcelMv));
+    sprintf(buf, "%.0f%%", benchSocPermille / 10.0f);
+    dtostrf(benchSetting, 3, 1, buf);
+    dtostrf(benchSetting, 4, 2, buf);
+    String ip = IPAddress(192, 168, 4, 1).toString();
+    benchSinkI = buf[0] + ip.length();
+}
+
+static void formatFixed() {
+    char buf[FMT_MAX_LEN];
+    const FmtSpec setting1 = {1000, 1, 3, ""};
+    const FmtSpec setting2 = {1000, 2, 4, ""};
+    fmtFixed(buf, sizeof(buf), benchVbatMv, FMT_VOLTS);
+    fmtFixed(buf, sizeof(buf), benchIbatMa, FMT_AMPS);
+    fmtFixed(buf, sizeof(buf), benchPbatMw, FMT_WATTS);
+    fmtFixed(buf, sizeof(buf), benchVcelMv, FMT_VOLTS);
+    fmtFixed(buf, sizeof(buf), benchSocPermille, FMT_PERCENT);
+    int32_t setting = toMilli(benchSetting);
+    fmtFixed(buf, sizeof(buf), setting, setting1);
+    fmtFixed(buf, sizeof(buf), setting, setting2);
+    benchSinkI = buf[0] + fmtIPv4(buf, sizeof(buf), IPAddress(192, 168, 4, 1));
+}
+
+// steady state: nothing changed since the last frame
+static void formatCached() {
+    static FmtCache cells[5];
+    benchSinkI = fmtCached(cells[0], benchVbatMv, FMT_VOLTS)[0] + fmtCached(cells[1], benchIbatMa, FMT_AMPS)[0] +
+                 fmtCached(cells[2], benchPbatMw, FMT_WATTS)[0] + fmtCached(cells[3], benchVcelMv, FMT_VOLTS)[0] +
+                 fmtCached(cells[4], benchSocPermille, FMT_PERCENT)[0];
+}
+
+static uint32_t measure(void (*tick)()) {
+    uint32_t start = ESP.getCycleCount();
+    for (int i = 0; i < BENCH_TICKS; i++) tick();
+    return (ESP.getCycleCount() - start) / BENCH_TICKS;
+}
+
+void runFixedPointBenchmark() {
+    uint32_t floatCycles = measure(floatTick);
+    uint32_t fixedCycles = measure(fixedTick);
+    Serial.printf("[bench] telemetry tick: float %lu cycles, fixed %lu cycles\n",
+                  (unsigned long)floatCycles, (unsigned long)fixedCycles);
+
+    uint32_t legacyCycles = measure(formatLegacy);
+    uint32_t fmtCycles = measure(formatFixed);
+    uint32_t cachedCycles = measure(formatCached);
+    Serial.printf("[bench] frame formatting: sprintf/dtostrf/String %lu cycles, fixed %lu cycles, cached %lu cycles\n",
+                  (unsigned long)legacyCycles, (unsigned long)fmtCycles, (unsigned long)cachedCycles);
+}
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#ifdef FIXEDPOINT_BENCH
+void runFixedPointBenchmark();
+#endif
+
+#endif
@@ -1,10 +1,12 @@
 #include "config.h"
 #include "system.h"
-#include <vector>
-
-Preferences preferences;
-std::vector<String> statusLogs;
-const int MAX_LOGS = 30;
+#include "soc.h"
+#include "protect.h"
+#include "settings.h"
+#include "statuslog.h"
+#include "journal.h"
+#include "wifimgr.h"
+#include "mppt.h"
 
 // --- Variables ---
 bool qm_usb_out = false;
@@ -26,6 +28,8 @@ float mppt_min_volt = 12.0;
 float mppt_max_volt = 18.0;
 float mppt_step = 0.2;
 float mppt_interval = 0.5;
+int mppt_algo_index = 0;
+int mppt_sweep_min = 10;
 
 bool fan_test_startup = true;
 int fan_min_pwm = 50;
@@ -42,6 +46,7 @@ float cal_sag_comp = 0.30;
 
 int wifi_mode_index = 0;
 bool sys_beeper = true;
+int stream_rate_index = 2;
 
 // --- WiFi Definitions ---
 const char* wifi_sta_ssid = "YOUR_WIFI_SSID";
@@ -70,6 +75,8 @@ unsigned long lastValueChangeTime = 0;
 const char* dcModeOptions[] = {"OFF", "OUT", "IN", "MPPT"};
 const char* chargeVoltOptions[] = {"4.10", "4.20", "4.25"};
 const char* wifiOptions[] = {"OFF", "STA", "AP"};
+const char* mpptAlgoOptions[MPPT_ALGORITHMS];  // filled from mpptStrategies in configSetup()
+const char* streamRateOptions[] = {"10", "20", "50", "100", "200"};
 
 // --- Actions ---
 void actionExit();
@@ -79,6 +86,8 @@ void actionRestore();
 void openPageCreds();
 void openPageLogs();
 void openPageAbout();
+void openPageDiag();
+void actionClearFault();
 
 void changeValue(MenuItem* item, bool increase) {
     if (!item->variable) return;
@@ -139,69 +148,74 @@ MenuItem menu_restore[] = {
 
 MenuItem menu_sys[] = {
     {"Back", ITEM_BACK, nullptr, (void*)actionBack},
-    {"Enable Beeper", ITEM_BOOL, &sys_beeper, nullptr, 0, 0, 0, nullptr, 0, true, "beep"},
+    {"Enable Beeper", ITEM_BOOL, &sys_beeper, nullptr, 0, 0, 0, nullptr, 0},
     {"Status Logs", ITEM_ACTION, nullptr, (void*)openPageLogs},
+    {"Diagnostics", ITEM_ACTION, nullptr, (void*)openPageDiag},
+    {"Stream Rate (Hz)", ITEM_STRING, &stream_rate_index, nullptr, 0, 0, 0, streamRateOptions, 5},
+    {"Clear Fault", ITEM_ACTION, nullptr, (void*)actionClearFault},
     {"Restore Defaults", ITEM_MENU, nullptr, menu_restore, 0, 0, 0, nullptr, 2},
     {"About", ITEM_ACTION, nullptr, (void*)openPageAbout}
 };
 
 MenuItem menu_wifi[] = {
     {"Back", ITEM_BACK, nullptr, (void*)actionBack},
-    {"Wi-Fi Mode", ITEM_STRING, &wifi_mode_index, nullptr, 0, 0, 0, wifiOptions, 3, true, "wifi"},
+    {"Wi-Fi Mode", ITEM_STRING, &wifi_mode_index, nullptr, 0, 0, 0, wifiOptions, 3},
     {"Wi-Fi Credentials", ITEM_ACTION, nullptr, (void*)openPageCreds}
 };
 
 MenuItem menu_cal[] = {
     {"Back", ITEM_BACK, nullptr, (void*)actionBack},
-    {"Min SOC Voltage (V)", ITEM_FLOAT, &cal_min_soc_vcel, nullptr, 2.5, 4.3, 0.01, nullptr, 0, true, "c_min", nullptr, &cal_max_soc_vcel},
-    {"Max SOC Voltage (V)", ITEM_FLOAT, &cal_max_soc_vcel, nullptr, 2.5, 4.3, 0.01, nullptr, 0, true, "c_max", &cal_min_soc_vcel, nullptr},
-    {"Sag Compensation", ITEM_FLOAT, &cal_sag_comp, nullptr, 0.01, 1.00, 0.01, nullptr, 0, true, "c_sag"}
+    {"Min SOC Voltage (V)", ITEM_FLOAT, &cal_min_soc_vcel, nullptr, 2.5, 4.3, 0.01, nullptr, 0, nullptr, &cal_max_soc_vcel},
+    {"Max SOC Voltage (V)", ITEM_FLOAT, &cal_max_soc_vcel, nullptr, 2.5, 4.3, 0.01, nullptr, 0, &cal_min_soc_vcel, nullptr},
+    {"Sag Compensation", ITEM_FLOAT, &cal_sag_comp, nullptr, 0.01, 1.00, 0.01, nullptr, 0}
 };
 
 MenuItem menu_temp[] = {
     {"Back", ITEM_BACK, nullptr, (void*)actionBack},
-    {"Startup Fan Test", ITEM_BOOL, &fan_test_startup, nullptr, 0, 0, 0, nullptr, 0, true, "f_test"},
-    {"Fan Min PWM %", ITEM_INT, &fan_min_pwm, nullptr, 0, 75, 1, nullptr, 0, true, "f_min"},
-    {"TBAT Min Temp (C)", ITEM_FLOAT, &tbat_min, nullptr, 25.0, 60.0, 1.0, nullptr, 0, true, "tb_min", nullptr, &tbat_max},
-    {"TBAT Max Temp (C)", ITEM_FLOAT, &tbat_max, nullptr, 25.0, 60.0, 1.0, nullptr, 0, true, "tb_max", &tbat_min, nullptr},
-    {"TMOD Min Temp (C)", ITEM_FLOAT, &tmod_min, nullptr, 25.0, 90.0, 1.0, nullptr, 0, true, "tm_min", nullptr, &tmod_max},
-    {"TMOD Max Temp (C)", ITEM_FLOAT, &tmod_max, nullptr, 25.0, 90.0, 1.0, nullptr, 0, true, "tm_max", &tmod_min, nullptr},
-    {"TINV Min Temp (C)", ITEM_FLOAT, &tinv_min, nullptr, 25.0, 90.0, 1.0, nullptr, 0, true, "ti_min", nullptr, &tinv_max},
-    {"TINV Max Temp (C)", ITEM_FLOAT, &tinv_max, nullptr, 25.0, 90.0, 1.0, nullptr, 0, true, "ti_max", &tinv_min, nullptr}
+    {"Startup Fan Test", ITEM_BOOL, &fan_test_startup, nullptr, 0, 0, 0, nullptr, 0},
+    {"Fan Min PWM %", ITEM_INT, &fan_min_pwm, nullptr, 0, 75, 1, nullptr, 0},
+    {"TBAT Min Temp (C)", ITEM_FLOAT, &tbat_min, nullptr, 25.0, 60.0, 1.0, nullptr, 0, nullptr, &tbat_max},
+    {"TBAT Max Temp (C)", ITEM_FLOAT, &tbat_max, nullptr, 25.0, 60.0, 1.0, nullptr, 0, &tbat_min, nullptr},
+    {"TMOD Min Temp (C)", ITEM_FLOAT, &tmod_min, nullptr, 25.0, 90.0, 1.0, nullptr, 0, nullptr, &tmod_max},
+    {"TMOD Max Temp (C)", ITEM_FLOAT, &tmod_max, nullptr, 25.0, 90.0, 1.0, nullptr, 0, &tmod_min, nullptr},
+    {"TINV Min Temp (C)", ITEM_FLOAT, &tinv_min, nullptr, 25.0, 90.0, 1.0, nullptr, 0, nullptr, &tinv_max},
+    {"TINV Max Temp (C)", ITEM_FLOAT, &tinv_max, nullptr, 25.0, 90.0, 1.0, nullptr, 0, &tinv_min, nullptr}
 };
 
 MenuItem menu_mppt[] = {
     {"Back", ITEM_BACK, nullptr, (void*)actionBack},
-    {"Start Voltage (V)", ITEM_FLOAT, &mppt_start_volt, nullptr, 7.0, 18.0, 0.1, nullptr, 0, true, "m_start"},
-    {"Min Voltage (V)", ITEM_FLOAT, &mppt_min_volt, nullptr, 5.0, 20.0, 0.1, nullptr, 0, true, "m_min", nullptr, &mppt_max_volt},
-    {"Max Voltage (V)", ITEM_FLOAT, &mppt_max_volt, nullptr, 5.0, 20.0, 0.1, nullptr, 0, true, "m_max", &mppt_min_volt, nullptr},
-    {"Perturb Step (V)", ITEM_FLOAT, &mppt_step, nullptr, 0.1, 1.0, 0.1, nullptr, 0, true, "m_step"},
-    {"Perturb Interval (s)", ITEM_FLOAT, &mppt_interval, nullptr, 0.1, 2.0, 0.1, nullptr, 0, true, "m_int"}
+    {"Start Voltage (V)", ITEM_FLOAT, &mppt_start_volt, nullptr, 7.0, 18.0, 0.1, nullptr, 0},
+    {"Min Voltage (V)", ITEM_FLOAT, &mppt_min_volt, nullptr, 5.0, 20.0, 0.1, nullptr, 0, nullptr, &mppt_max_volt},
+    {"Max Voltage (V)", ITEM_FLOAT, &mppt_max_volt, nullptr, 5.0, 20.0, 0.1, nullptr, 0, &mppt_min_volt, nullptr},
+    {"Perturb Step (V)", ITEM_FLOAT, &mppt_step, nullptr, 0.1, 1.0, 0.1, nullptr, 0},
+    {"Perturb Interval (s)", ITEM_FLOAT, &mppt_interval, nullptr, 0.1, 2.0, 0.1, nullptr, 0},
+    {"Algorithm", ITEM_STRING, &mppt_algo_index, nullptr, 0, 0, 0, mpptAlgoOptions, MPPT_ALGORITHMS},
+    {"Sweep Every (mins)", ITEM_INT, &mppt_sweep_min, nullptr, 0, 60, 1, nullptr, 0}
 };
 
 MenuItem menu_sc[] = {
     {"Back", ITEM_BACK, nullptr, (void*)actionBack},
-    {"Charge Voltage (V)", ITEM_STRING, &sc_charge_volt_index, nullptr, 0, 0, 0, chargeVoltOptions, 3, true, "sc_v"},
-    {"IBAT Limit (A)", ITEM_FLOAT, &sc_ibat_limit, nullptr, 2.0, 12.0, 0.1, nullptr, 0, true, "sc_i"}
+    {"Charge Voltage (V)", ITEM_STRING, &sc_charge_volt_index, nullptr, 0, 0, 0, chargeVoltOptions, 3},
+    {"IBAT Limit (A)", ITEM_FLOAT, &sc_ibat_limit, nullptr, 2.0, 12.0, 0.1, nullptr, 0}
 };
 
 MenuItem menu_apo[] = {
     {"Back", ITEM_BACK, nullptr, (void*)actionBack},
-    {"Enable APO", ITEM_BOOL, &apo_enable, nullptr, 0, 0, 0, nullptr, 0, true, "apo_en"},
-    {"APO Thres (mA)", ITEM_INT, &apo_curr_thres, nullptr, 5, 200, 5, nullptr, 0, true, "apo_th"},
-    {"APO AC Thres (mA)", ITEM_INT, &apo_ac_thres, nullptr, 5, 500, 5, nullptr, 0, true, "apo_ac"},
-    {"APO Delay (mins)", ITEM_INT, &apo_delay, nullptr, 1, 60, 1, nullptr, 0, true, "apo_del"}
+    {"Enable APO", ITEM_BOOL, &apo_enable, nullptr, 0, 0, 0, nullptr, 0},
+    {"APO Thres (mA)", ITEM_INT, &apo_curr_thres, nullptr, 5, 200, 5, nullptr, 0},
+    {"APO AC Thres (mA)", ITEM_INT, &apo_ac_thres, nullptr, 5, 500, 5, nullptr, 0},
+    {"APO Delay (mins)", ITEM_INT, &apo_delay, nullptr, 1, 60, 1, nullptr, 0}
 };
 
 MenuItem mainMenu[] = {
     {"Exit", ITEM_ACTION, nullptr, (void*)actionExit},
     {"Auto Power Off", ITEM_MENU, nullptr, menu_apo, 0, 0, 0, nullptr, 5}, 
     {"SC8812A Parameters", ITEM_MENU, nullptr, menu_sc, 0, 0, 0, nullptr, 3},
-    {"MPPT Parameters", ITEM_MENU, nullptr, menu_mppt, 0, 0, 0, nullptr, 6},
+    {"MPPT Parameters", ITEM_MENU, nullptr, menu_mppt, 0, 0, 0, nullptr, 8},
     {"Temperature Control", ITEM_MENU, nullptr, menu_temp, 0, 0, 0, nullptr, 9},
     {"Calibration", ITEM_MENU, nullptr, menu_cal, 0, 0, 0, nullptr, 4},
     {"Wi-Fi", ITEM_MENU, nullptr, menu_wifi, 0, 0, 0, nullptr, 3},
-    {"System Settings", ITEM_MENU, nullptr, menu_sys, 0, 0, 0, nullptr, 5}
+    {"System Settings", ITEM_MENU, nullptr, menu_sys, 0, 0, 0, nullptr, 8}
 };
 
 MenuItem quickMenu[] = {
@@ -209,67 +223,14 @@ MenuItem quickMenu[] = {
     {"USB", ITEM_BOOL, &qm_usb_out, nullptr},
     {"AC", ITEM_BOOL, &qm_ac_out, nullptr},
     {"DC-M", ITEM_STRING, &qm_dc_mode_index, nullptr, 0, 0, 0, dcModeOptions, 4},
-    {"DC-V", ITEM_FLOAT, &qm_dc_vbus, nullptr, 1.0, 20.0, 0.1, nullptr, 0, true, "dcv"},
-    {"DC-I", ITEM_FLOAT, &qm_dc_ibus, nullptr, 0.3, 6.0, 0.1, nullptr, 0, true, "dci"},
+    {"DC-V", ITEM_FLOAT, &qm_dc_vbus, nullptr, 1.0, 20.0, 0.1, nullptr, 0},
+    {"DC-I", ITEM_FLOAT, &qm_dc_ibus, nullptr, 0.3, 6.0, 0.1, nullptr, 0},
     {"Shutdown", ITEM_ACTION, nullptr, (void*)actionShutdown}
 };
 
-void logStatus(const char* msg) {
-    if (statusLogs.size() >= MAX_LOGS) {
-        statusLogs.erase(statusLogs.begin());
-    }
-    statusLogs.push_back(String(msg));
-}
-
-String getLogLine(int index) {
-    if (index >= 0 && index < statusLogs.size()) return statusLogs[index];
-    return "";
-}
-
-int getLogCount() {
-    return statusLogs.size();
-}
-
-void saveSetting(const char* key, void* val, ItemType type) {
-    if (!key) return;
-    if (type == ITEM_BOOL) preferences.putBool(key, *(bool*)val);
-    else if (type == ITEM_INT) preferences.putInt(key, *(int*)val);
-    else if (type == ITEM_FLOAT) preferences.putFloat(key, *(float*)val);
-    else if (type == ITEM_STRING) preferences.putInt(key, *(int*)val);
-}
-
-void loadSettings() {
-    preferences.begin("settings", false);
-    qm_dc_vbus = preferences.getFloat("dcv", qm_dc_vbus);
-    qm_dc_ibus = preferences.getFloat("dci", qm_dc_ibus);
-    apo_enable = preferences.getBool("apo_en", apo_enable);
-    apo_curr_thres = preferences.getInt("apo_th", apo_curr_thres);
-    apo_ac_thres = preferences.getInt("apo_ac", apo_ac_thres);
-    apo_delay = preferences.getInt("apo_del", apo_delay);
-    sc_charge_volt_index = preferences.getInt("sc_v", sc_charge_volt_index);
-    sc_ibat_limit = preferences.getFloat("sc_i", sc_ibat_limit);
-    mppt_start_volt = preferences.getFloat("m_start", mppt_start_volt);
-    mppt_min_volt = preferences.getFloat("m_min", mppt_min_volt);
-    mppt_max_volt = preferences.getFloat("m_max", mppt_max_volt);
-    mppt_step = preferences.getFloat("m_step", mppt_step);
-    mppt_interval = preferences.getFloat("m_int", mppt_interval);
-    fan_test_startup = preferences.getBool("f_test", fan_test_startup);
-    fan_min_pwm = preferences.getInt("f_min", fan_min_pwm);
-    tbat_min = preferences.getFloat("tb_min", tbat_min);
-    tbat_max = preferences.getFloat("tb_max", tbat_max);
-    tmod_min = preferences.getFloat("tm_min", tmod_min);
-    tmod_max = preferences.getFloat("tm_max", tmod_max);
-    tinv_min = preferences.getFloat("ti_min", tinv_min);
-    tinv_max = preferences.getFloat("ti_max", tinv_max);
-    cal_min_soc_vcel = preferences.getFloat("c_min", cal_min_soc_vcel);
-    cal_max_soc_vcel = preferences.getFloat("c_max", cal_max_soc_vcel);
-    cal_sag_comp = preferences.getFloat("c_sag", cal_sag_comp);
-    wifi_mode_index = preferences.getInt("wifi", wifi_mode_index);
-    sys_beeper = preferences.getBool("beep", sys_beeper);
-}
-
 void configSetup() {
-    loadSettings();
+    for (int i = 0; i < MPPT_ALGORITHMS; i++) mpptAlgoOptions[i] = mpptStrategies[i].name;
+    settingsLoad();
     currentMenu = mainMenu;
     currentMenuSize = sizeof(mainMenu) / sizeof(MenuItem);
 }
@@ -297,9 +258,18 @@ void actionShutdown() {
     executeShutdown();
 }
 
+void actionClearFault() {
+    if (!protectTripped()) return;
+    protectClear();
+    logEvent(LOG_INFO, EV_FAULT_CLEARED);
+    applyPowerSettings();
+}
+
 void actionRestore() {
-    preferences.clear();
-    logStatus("Settings Cleared");
+    settingsClear();
+    logEvent(LOG_WARN, EV_SETTINGS_CLEARED);
+    journalFlush();
+    socSave();
     delay(500);
     ESP.restart();
 }
@@ -307,6 +277,7 @@ void actionRestore() {
 void openPageCreds() { screenSelect = 2; activePageId = 1; }
 void openPageLogs() { screenSelect = 2; activePageId = 2; }
 void openPageAbout() { screenSelect = 2; activePageId = 3; }
+void openPageDiag() { screenSelect = 2; activePageId = 4; }
 
 void handleMenuLogic() {
     bool up = getButtonState(0);
@@ -328,25 +299,21 @@ void handleMenuLogic() {
             }
             else if (item->type == ITEM_BOOL) {
                 changeValue(item, true);
-                if (item->persist && item->prefKey) saveSetting(item->prefKey, item->variable, item->type);
+                if (settingsPersists(item->variable)) settingsMarkDirty();
                 applyPowerSettings();
                 
-                char buf[20];
-                sprintf(buf, "%s: %s", item->name, *(bool*)item->variable ? "ON" : "OFF");
-                logStatus(buf);
+                logEvent(LOG_INFO, EV_OUTPUT, *(bool*)item->variable, 0, 0, item->name);
             }
             else {
                 isQuickMenuEditing = !isQuickMenuEditing;
                 if (!isQuickMenuEditing) {
-                    if (item->persist && item->prefKey) {
-                        saveSetting(item->prefKey, item->variable, item->type);
-                    }
+                    if (settingsPersists(item->variable)) settingsMarkDirty();
                     if (item->variable == &qm_dc_vbus || 
                         item->variable == &qm_dc_ibus || 
                         item->variable == &qm_dc_mode_index) {
                         applyPowerSettings();
                         
-                        logStatus("DC Params Set");
+                        logEvent(LOG_INFO, EV_DC_SET);
                     }
                 }
             }
@@ -390,17 +357,15 @@ void handleMenuLogic() {
             } 
             else if (item->type == ITEM_BOOL) {
                 changeValue(item, true);
-                if (item->persist && item->prefKey) saveSetting(item->prefKey, item->variable, item->type);
+                if (settingsPersists(item->variable)) settingsMarkDirty();
                 if (item->variable == &fan_test_startup) { /* Optional: trigger fan logic */ }
             } 
             else {
                 isEditing = !isEditing;
                 if (!isEditing) {
-                    if (item->persist && item->prefKey) {
-                        saveSetting(item->prefKey, item->variable, item->type);
-                    }
+                    if (settingsPersists(item->variable)) settingsMarkDirty();
                     if (item->variable == &wifi_mode_index) {
-                        setupWiFi(wifi_mode_index);
+                        wifiRequest(wifi_mode_index);
                     }
                     if (item->variable == &sc_charge_volt_index || item->variable == &sc_ibat_limit) {
                         applySC8812AParams();
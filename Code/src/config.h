@@ -25,8 +25,6 @@ struct MenuItem {
     float step;
     const char** options;
     int numOptions;
-    bool persist;
-    const char* prefKey;
     const void* dynMin; 
     const void* dynMax;
 };
@@ -38,8 +36,6 @@ struct MenuState {
     int view;
 };
 
-extern Preferences preferences;
-
 // --- Menu State ---
 extern MenuItem quickMenu[]; 
 extern int quickMenuCursor;
@@ -73,6 +69,8 @@ extern float mppt_min_volt;
 extern float mppt_max_volt;
 extern float mppt_step;
 extern float mppt_interval;
+extern int mppt_algo_index;
+extern int mppt_sweep_min;
 
 extern bool fan_test_startup;
 extern int fan_min_pwm;
@@ -89,6 +87,7 @@ extern float cal_sag_comp;
 
 extern int wifi_mode_index;
 extern bool sys_beeper;
+extern int stream_rate_index;
 
 // --- [NEW] WiFi & Web Settings ---
 extern const char* wifi_sta_ssid;
@@ -99,11 +98,6 @@ extern const char* web_address;
 
 // --- Functions ---
 void configSetup();
-void loadSettings();
-void saveSetting(const char* key, void* val, ItemType type);
 void handleMenuLogic();
-void logStatus(const char* msg);
-String getLogLine(int index);
-int getLogCount();
 
 #endif
\ No newline at end of file
@@ -0,0 +1,19 @@
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// CRC-32 (IEEE, reflected), bitwise: blocks checked here are a few hundred bytes at most.
+// Plain C headers only, the host telemetry decoder uses it too.
+inline uint32_t crc32(const void* data, size_t len, uint32_t crc = 0) {
+    const uint8_t* p = (const uint8_t*)data;
+    crc = ~crc;
+    while (len--) {
+        crc ^= *p++;
+        for (int k = 0; k < 8; k++) crc = (crc >> 1) ^ (0xEDB88320UL & (0 - (crc & 1)));
+    }
+    return ~crc;
+}
+
+#endif
@@ -1,10 +1,134 @@
 #include "display.h"
 #include "system.h"
+#include "i2cbus.h"
+#include "tasks.h"
+#include "profiler.h"
+#include "power.h"
+#include "format.h"
+#include "settings.h"
+#include "statuslog.h"
+#include "journal.h"
+#include "telemstream.h"
+#include "wifimgr.h"
+#include "mppt.h"
+#include "protect.h"
 
 U8G2_SH1106_128X64_NONAME_F_HW_I2C u8g2(U8G2_R0, U8X8_PIN_NONE, SCL_PIN, SDA_PIN);
 
 extern int pageScrollY; 
 
+DisplayStats displayStats = {0, 0, FRAME_MIN_MS};
+
+// Only 8x8 tiles that differ from the front buffer are sent, one bus job per
+// run of dirty tiles in a tile row. Spans queued is only written by the
+// display task, spans sent only by the bus task.
+volatile uint32_t frameSpansQueued = 0;
+volatile uint32_t frameSpansSent = 0;
+volatile uint32_t displayBytesSent = 0;
+
+const int TILE_GAP_MERGE = 2;  // clean tiles bridged rather than paying for another addressing sequence
+uint8_t frontFrame[128 * 64 / 8];
+bool frontFrameValid = false;
+bool framePending = false;     // back buffer rendered, not flipped yet
+bool flipInFlight = false;
+uint32_t flipStartUs = 0;
+uint32_t flipFirstSpan = 0;
+volatile uint32_t spanSentUs = 0; // bus task: when the latest span went out
+
+UiSnapshot uiSlots[2] = {};
+volatile uint32_t uiSeq = 0;
+
+// --- Frame Transfer ---
+
+// ctx packs row | first tile << 8 | tile count << 16
+bool sendTileSpanJob(void* ctx) {
+    uint32_t span = (uint32_t)(uintptr_t)ctx;
+    uint8_t row = span & 0xFF, first = (span >> 8) & 0xFF, count = (span >> 16) & 0xFF;
+    u8x8_DrawTile(u8g2.getU8x8(), first, row, count, frontFrame + (row * u8g2.getBufferTileWidth() + first) * 8);
+    spanSentUs = micros(); // written before the done callback counts the span
+    return true;
+}
+
+void tileSpanDone(void* ctx, bool ok) {
+    displayBytesSent += (((uint32_t)(uintptr_t)ctx >> 16) & 0xFF) * 8;
+    frameSpansSent++;
+}
+
+static bool queueSpan(int row, int first, int count) {
+    uint32_t span = row | (first << 8) | (count << 16);
+    if (!i2cSubmit(I2C_PRIO_DISPLAY, sendTileSpanJob, tileSpanDone, (void*)(uintptr_t)span)) return false;
+    frameSpansQueued++;
+    return true;
+}
+
+static void updateByteRate() {
+    static unsigned long windowStart = 0;
+    static uint32_t windowBytes = 0;
+    unsigned long now = millis();
+    if (now - windowStart < 1000) return;
+    uint32_t sent = displayBytesSent;
+    displayStats.bytesPerSec = (sent - windowBytes) * 1000 / (now - windowStart);
+    windowBytes = sent;
+    windowStart = now;
+}
+
+// Copy the dirty tiles of the back buffer into the front buffer and queue them.
+static void flipFrame() {
+    uint8_t* buf = u8g2.getBufferPtr();
+    int rows = u8g2.getBufferTileHeight();
+    int cols = u8g2.getBufferTileWidth();
+
+    framePending = false;
+    flipInFlight = true;
+    flipStartUs = micros();
+    flipFirstSpan = frameSpansQueued;
+    for (int row = 0; row < rows; row++) {
+        int first = -1, last = -1;
+        for (int tx = 0; tx <= cols; tx++) {
+            bool dirty = false;
+            if (tx < cols) {
+                uint8_t* tile = buf + (row * cols + tx) * 8;
+                uint8_t* front = frontFrame + (row * cols + tx) * 8;
+                dirty = !frontFrameValid || memcmp(tile, front, 8) != 0;
+                if (dirty) memcpy(front, tile, 8);
+            }
+            if (dirty) {
+                if (first < 0) first = tx;
+                last = tx;
+            } else if (first >= 0 && (tx == cols || tx - last > TILE_GAP_MERGE)) {
+                if (!queueSpan(row, first, last - first + 1)) {
+                    frontFrameValid = false; // queue full, repaint everything next time
+                    return;
+                }
+                first = -1;
+            }
+        }
+    }
+    frontFrameValid = true;
+}
+
+// A flip that took more than half the interval means the bus is busy with
+// higher priority work: back off. Drift back down while it drains quickly.
+static void finishFlip() {
+    // timed to the last span on the wire, not to the tick that noticed it
+    uint32_t us = (frameSpansQueued == flipFirstSpan) ? 0 : spanSentUs - flipStartUs;
+    flipInFlight = false;
+    displayStats.frames++;
+    displayStats.flipLastUs = us;
+    if (us > displayStats.flipMaxUs) displayStats.flipMaxUs = us;
+
+    if (us * 2 > displayStats.intervalMs * 1000) {
+        displayStats.intervalMs = min((uint32_t)FRAME_MAX_MS, displayStats.intervalMs * 3 / 2);
+    } else if (us * 4 < displayStats.intervalMs * 1000 && displayStats.intervalMs > FRAME_MIN_MS) {
+        displayStats.intervalMs = max((uint32_t)FRAME_MIN_MS, displayStats.intervalMs - 10);
+    }
+}
+
+bool displayBeginJob(void* ctx) {
+    u8g2.begin();
+    return true;
+}
+
 // --- Helper Functions  ---
 
 void drawLabelAndValue(int x, int y, int width, const char* label, const char* valueStr) {
@@ -14,108 +138,216 @@ void drawLabelAndValue(int x, int y, int width, const char* label, const char* v
     u8g2.drawStr(valueX, y, valueStr);
 }
 
-void drawBatteryIndicator(int x, int y, int width, int height, float soc_percent) {
+void drawBatteryIndicator(int x, int y, int width, int height, int32_t socPermille) {
     u8g2.drawRFrame(x, y, width, height, 3);
     int terminalWidth = width / 24;
     int terminalHeight = height / 3;
     u8g2.drawBox(x + width, y + (height / 2) - (terminalHeight / 2), terminalWidth, terminalHeight);
     
-    soc_percent = constrain(soc_percent, 0.0f, 100.0f);
+    socPermille = constrain(socPermille, 0, 1000);
     int maxFill = width - 4; 
-    int fillWidth = map(soc_percent, 0, 100, 0, maxFill);
-    if (soc_percent > 0.0f) fillWidth = max(fillWidth, 4);
+    int fillWidth = socPermille * maxFill / 1000;
+    if (socPermille > 0) fillWidth = max(fillWidth, 4);
     fillWidth = min(fillWidth, maxFill);
     
-    if (soc_percent > 0.0f) u8g2.drawRBox(x + 2, y + 2, fillWidth, height - 4, 2);
+    if (socPermille > 0) u8g2.drawRBox(x + 2, y + 2, fillWidth, height - 4, 2);
 }
 
-void drawTelemetryPanel(int x, int y, int width, const char* labels[], float* values, const char* formats[], int count) {
+// Battery outline with the time to empty beside it, "--" unless discharging
+static void drawBatteryFooter(const TelemetrySnapshot& t) {
+    drawBatteryIndicator(59, 48, 32, 12, t.soc_permille);
+    char tte[8];
+    if (t.tteMin < 0) snprintf(tte, sizeof(tte), "--");
+    else if (t.tteMin >= 100 * 60) snprintf(tte, sizeof(tte), ">99h");
+    else snprintf(tte, sizeof(tte), "%ld:%02ld", (long)(t.tteMin / 60), (long)(t.tteMin % 60));
+    u8g2.drawStr(120 - u8g2.getStrWidth(tte), 57, tte);
+}
+
+void drawTelemetryPanel(int x, int y, int width, const char* labels[], const char* texts[], int count) {
     const int ySpacing = 8;
     const int topPadding = 9;
     int height = (count * ySpacing) + 4;
 
     u8g2.drawFrame(x, y, width, height);
 
-    char valueBuffer[20];
     for (int i = 0; i < count; i++) {
         int yPos = y + topPadding + (i * ySpacing);
-        sprintf(valueBuffer, formats[i], values[i]);
-        drawLabelAndValue(x, yPos, width, labels[i], valueBuffer);
+        drawLabelAndValue(x, yPos, width, labels[i], texts[i]);
     }
 }
 
+// --- UI Snapshot ---
+
+const int MENU_VISIBLE_ROWS = 5;
+const int QUICK_MENU_ROWS = 7;
+
+// A row is only reformatted when its item or integer value changes.
+struct RowCache {
+    const MenuItem* item;
+    int32_t raw;
+    char value[sizeof(((UiRow*)0)->value)];
+};
+
+RowCache rowCache[UI_ROWS];
+
+// floats in milli units
+static int32_t itemRaw(const MenuItem* item) {
+    switch (item->type) {
+        case ITEM_BOOL:   return *(bool*)item->variable;
+        case ITEM_INT:
+        case ITEM_STRING: return *(int*)item->variable;
+        case ITEM_FLOAT:  return toMilli(*(float*)item->variable);
+        default: return 0;
+    }
+}
+
+static void formatQuickItem(const MenuItem* item, int32_t raw, char* out, size_t len) {
+    const FmtSpec spec = {1000, 1, 3, ""};
+    out[0] = '\0';
+    if (item->type == ITEM_BOOL) snprintf(out, len, "%s", raw ? "ON" : "OFF");
+    else if (item->type == ITEM_FLOAT) fmtFixed(out, len, raw, spec);
+    else if (item->type == ITEM_STRING) snprintf(out, len, "%s", item->options[raw]);
+}
+
+static void formatMenuItem(const MenuItem* item, int32_t raw, char* out, size_t len) {
+    const FmtSpec spec = {1000, (uint8_t)((item->step < 1.0)? 2 : 1), 4, ""};
+    switch (item->type) {
+        case ITEM_INT:    snprintf(out, len, "%ld", (long)raw); break;
+        case ITEM_FLOAT:  fmtFixed(out, len, raw, spec); break;
+        case ITEM_BOOL:   snprintf(out, len, "%s", raw ? "On" : "Off"); break;
+        case ITEM_STRING: snprintf(out, len, "%s", item->options[raw]); break;
+        default: out[0] = '\0'; break;
+    }
+}
+
+static void publishRow(UiRow& row, int slot, const MenuItem* item, bool quick) {
+    RowCache& c = rowCache[slot];
+    int32_t raw = itemRaw(item);
+    if (c.item != item || c.raw != raw) {
+        if (quick) formatQuickItem(item, raw, c.value, sizeof(c.value));
+        else formatMenuItem(item, raw, c.value, sizeof(c.value));
+        c.item = item;
+        c.raw = raw;
+    }
+    row.name = item->name;
+    memcpy(row.value, c.value, sizeof(row.value));
+}
+
+void uiPublish() {
+    uint32_t next = uiSeq + 1;
+    UiSnapshot& s = uiSlots[next & 1];
+
+    s.screen = screenSelect;
+    s.statusView = statusViewIndex;
+    s.pageId = activePageId;
+    s.pageScroll = pageScrollY;
+    s.apoEnabled = apo_enable;
+    s.apoCountingDown = apoCountingDown;
+    s.fanPercent = fanPercent;
+    s.view = 0;
+    s.rowCount = 0;
+
+    if (screenSelect == 0) {
+        s.cursor = quickMenuCursor;
+        s.editing = isQuickMenuEditing;
+        for (int i = 0; i < QUICK_MENU_ROWS; i++) {
+            publishRow(s.rows[i], i, &quickMenu[i], true);
+        }
+        s.rowCount = QUICK_MENU_ROWS;
+    } else if (screenSelect == 1) {
+        s.cursor = cursorPosition;
+        s.view = viewPosition;
+        s.editing = isEditing;
+        for (int i = 0; i < MENU_VISIBLE_ROWS && viewPosition + i < currentMenuSize; i++) {
+            publishRow(s.rows[i], i, &currentMenu[viewPosition + i], false);
+            s.rowCount++;
+        }
+    }
+
+    __sync_synchronize();
+    uiSeq = next;
+}
+
+static void uiRead(UiSnapshot& s) {
+    uint32_t seq;
+    do {
+        seq = uiSeq;
+        __sync_synchronize();
+        s = uiSlots[seq & 1];
+        __sync_synchronize();
+    } while (uiSeq != seq); // same rule as telemetryRead: any publish may have torn the copy
+}
+
 // --- Component Drawers ---
 
-void drawQuickMenu() {
+static void drawQuickMenu(const UiSnapshot& ui) {
     const int frameX = 0, frameY = 0, frameWidth = 55;
     const int textPadding = 3;
     const int cursorWidth = 6;
     const int QUICK_MENU_Y_SPACING = 8;
 
-    int frameHeight = (7 * QUICK_MENU_Y_SPACING) + textPadding + 1; // 7 items
+    int frameHeight = (QUICK_MENU_ROWS * QUICK_MENU_Y_SPACING) + textPadding + 1;
     u8g2.drawFrame(frameX, frameY, frameWidth, frameHeight);
 
-    for (int i = 0; i < 7; i++) {
-        MenuItem* item = &quickMenu[i];
+    for (int i = 0; i < ui.rowCount; i++) {
         int yPos = frameY + 1 + (i * QUICK_MENU_Y_SPACING) + QUICK_MENU_Y_SPACING;
 
-        bool showCursor = !isQuickMenuEditing || (i != quickMenuCursor) || (millis() % 800) > 400;
-        if (i == quickMenuCursor && showCursor) {
+        bool showCursor = !ui.editing || (i != ui.cursor) || (millis() % 800) > 400;
+        if (i == ui.cursor && showCursor) {
             u8g2.drawStr(2, yPos, ">");
         }
 
-        u8g2.drawStr(frameX + textPadding + cursorWidth - 1, yPos, item->name);
+        u8g2.drawStr(frameX + textPadding + cursorWidth - 1, yPos, ui.rows[i].name);
 
-        if (item->type != ITEM_ACTION) {
-            char valueStr[16] = "";
-            if (item->type == ITEM_BOOL) sprintf(valueStr, "%s", *(bool*)item->variable ? "ON" : "OFF");
-            else if (item->type == ITEM_FLOAT) dtostrf(*(float*)item->variable, 3, 1, valueStr);
-            else if (item->type == ITEM_STRING) strncpy(valueStr, item->options[*(int*)item->variable], 15);
-            
-            int valueX = (frameX + frameWidth) - textPadding - u8g2.getStrWidth(valueStr);
-            u8g2.drawStr(valueX, yPos, valueStr);
-        }
+        const char* valueStr = ui.rows[i].value;
+        int valueX = (frameX + frameWidth) - textPadding - u8g2.getStrWidth(valueStr);
+        u8g2.drawStr(valueX, yPos, valueStr);
     }
 }
 
 // --- Main Screens ---
 
-void drawStatusScreen() {
-    u8g2.clearBuffer();
-    drawQuickMenu();
+static void drawStatusScreen(const UiSnapshot& ui, const TelemetrySnapshot& t) {
+    drawQuickMenu(ui);
 
     const int PANEL_X = 57;
     const int PANEL_WIDTH = 60;
 
-    if (statusViewIndex == 0) { // Main Battery Info
+    // one cache per panel cell, shared by the views
+    static FmtCache cells[6];
+
+    if (ui.statusView == 0) { // Main Battery Info
         const char* labels[] = {"VBAT", "IBAT", "PBAT", "VCEL", "SOC"};
-        float vals[] = {vbat_read, ibat_read, pbat_read, vcel_read, soc};
-        const char* fmts[] = {"%.2fV", "%.2fA", "%.0fW", "%.2fV", "%.0f%%"};
-        drawTelemetryPanel(PANEL_X, 0, PANEL_WIDTH, labels, vals, fmts, 5);
-        drawBatteryIndicator(59, 48, 52, 12, soc);
+        const char* texts[] = {fmtCached(cells[0], t.vbat_mv, FMT_VOLTS), fmtCached(cells[1], t.ibat_ma, FMT_AMPS),
+                               fmtCached(cells[2], t.pbat_mw, FMT_WATTS), fmtCached(cells[3], t.vcel_mv, FMT_VOLTS),
+                               fmtCached(cells[4], t.soc_permille, FMT_PERCENT)};
+        drawTelemetryPanel(PANEL_X, 0, PANEL_WIDTH, labels, texts, 5);
+        drawBatteryFooter(t);
     } 
-    else if (statusViewIndex == 1) { // Power View
+    else if (ui.statusView == 1) { // Power View
         const char* l1[] = {"VBAT", "IBAT", "PBAT"};
-        float v1[] = {vbat_read, ibat_read, pbat_read};
-        const char* f1[] = {"%.2fV", "%.2fA", "%.0fW"};
-        drawTelemetryPanel(PANEL_X, 0, PANEL_WIDTH, l1, v1, f1, 3);
+        const char* t1[] = {fmtCached(cells[0], t.vbat_mv, FMT_VOLTS), fmtCached(cells[1], t.ibat_ma, FMT_AMPS),
+                            fmtCached(cells[2], t.pbat_mw, FMT_WATTS)};
+        drawTelemetryPanel(PANEL_X, 0, PANEL_WIDTH, l1, t1, 3);
         
         const char* l2[] = {"VBUS", "IBUS", "PBUS"};
-        float v2[] = {vbus_read, ibus_read, pbus_read};
-        const char* f2[] = {"%.2fV", "%.2fA", "%.0fW"};
-        drawTelemetryPanel(PANEL_X, 30, PANEL_WIDTH, l2, v2, f2, 3);
+        const char* t2[] = {fmtCached(cells[3], t.vbus_mv, FMT_VOLTS), fmtCached(cells[4], t.ibus_ma, FMT_AMPS),
+                            fmtCached(cells[5], t.pbus_mw, FMT_WATTS)};
+        drawTelemetryPanel(PANEL_X, 30, PANEL_WIDTH, l2, t2, 3);
     }
-    else if (statusViewIndex == 2) { // Temp View
-        float fSpeedPercent = fanSpeed * 100.0;
+    else if (ui.statusView == 2) { // Temp View
         const char* labels[] = {"TBAT", "TTMD", "TBMD", "TINV", "FAN"};
-        float vals[] = {tempReadings[0], tempReadings[1], tempReadings[2], tempReadings[3], fSpeedPercent};
-        const char* fmts[] = {"%.1fC", "%.1fC", "%.1fC", "%.1fC", "%.0f%%"};
-        drawTelemetryPanel(PANEL_X, 0, PANEL_WIDTH, labels, vals, fmts, 5);
-        drawBatteryIndicator(59, 48, 52, 12, soc);
+        const char* texts[5];
+        for (int i = 0; i < 4; i++) {
+            texts[i] = t.tempStale[i] ? "--.-C" : fmtCached(cells[i], t.tempCenti[i], FMT_CELSIUS);
+        }
+        texts[4] = fmtCached(cells[4], ui.fanPercent * 10, FMT_PERCENT);
+        drawTelemetryPanel(PANEL_X, 0, PANEL_WIDTH, labels, texts, 5);
+        drawBatteryFooter(t);
     }
 
-    if (apo_enable) {
-        if (apoCountingDown) {
+    if (ui.apoEnabled) {
+        if (ui.apoCountingDown) {
             if ((millis() % 1000) > 500) {
                 u8g2.drawRBox(124, 60, 4, 4, 1);
             }
@@ -123,95 +355,189 @@ void drawStatusScreen() {
             u8g2.drawRBox(124, 60, 4, 4, 1);
         }
     }
-
-    u8g2.sendBuffer();
 }
 
-void drawMenu() {
-    u8g2.clearBuffer();
-
-    const int VISIBLE_ROWS = 5;
+static void drawMenu(const UiSnapshot& ui) {
     const int ROW_HEIGHT = 12;
 
-    for (int i = 0; i < VISIBLE_ROWS; i++) {
-        int itemIndex = viewPosition + i;
-        if (itemIndex >= currentMenuSize) break;
+    for (int i = 0; i < ui.rowCount; i++) {
         int yPos = (i * ROW_HEIGHT) + ROW_HEIGHT - 2;
-        
-        u8g2.drawStr(2, yPos, currentMenu[itemIndex].name);
-        
-        char valueBuffer[16];
-        MenuItem* item = &currentMenu[itemIndex];
-        
-        switch (item->type) {
-            case ITEM_INT:    sprintf(valueBuffer, "%d", *(int*)item->variable); break;
-            case ITEM_FLOAT:  dtostrf(*(float*)item->variable, 4, (item->step < 1.0)? 2 : 1, valueBuffer); break;
-            case ITEM_BOOL:   sprintf(valueBuffer, "%s", *(bool*)item->variable ? "On" : "Off"); break;
-            case ITEM_STRING: strncpy(valueBuffer, item->options[*(int*)item->variable], 15); break;
-            default: valueBuffer[0] = '\0'; break;
-        }
-        
+        u8g2.drawStr(2, yPos, ui.rows[i].name);
+
+        const char* valueBuffer = ui.rows[i].value;
         if (valueBuffer[0] != '\0') {
             u8g2.drawStr(127 - u8g2.getStrWidth(valueBuffer), yPos, valueBuffer);
         }
     }
 
-    int cursorY = (cursorPosition - viewPosition) * ROW_HEIGHT;
-    bool showCursor = !isEditing || (millis() % 800) > 400;
+    int cursorY = (ui.cursor - ui.view) * ROW_HEIGHT;
+    bool showCursor = !ui.editing || (millis() % 800) > 400;
     if (showCursor) {
         u8g2.drawHLine(0, cursorY + 1, 128);
         u8g2.drawHLine(0, cursorY + ROW_HEIGHT, 128);
     }
-    u8g2.sendBuffer();
 }
 
-void drawPage() {
-    u8g2.clearBuffer();
+static const FmtSpec DIAG_EFFICIENCY = {10, 1, 0, "%"};  // permille
+static const FmtSpec DIAG_WATT_HOURS = {1000, 1, 0, "Wh"}; // mWh
+
+static void drawPage(const UiSnapshot& ui) {
     u8g2.setFont(u8g2_font_profont10_tf);
     int maxLines = 6;
     
-    if (activePageId == 1) { 
+    if (ui.pageId == 1) { 
         u8g2.drawStr(0, 10, "   --- Credentials ---");
-        char lines[7][30];
+        char lines[8][30];
         
         sprintf(lines[0], "Web: %s", web_address);
-        sprintf(lines[1], "STA SSID: %s", wifi_sta_ssid);
-        sprintf(lines[2], "STA Pass: %s", wifi_sta_pass); 
-        sprintf(lines[3], "STA IP: %s", WiFi.localIP().toString().c_str());
+        const char* ap = wifiStats.fallbackAp ? " +AP" : "";
+        if (wifiStats.state == NET_CONNECTED) {
+            snprintf(lines[1], sizeof(lines[1]), "Link: %s %ddBm%s", wifiStateName(), (int)wifiStats.rssi, ap);
+        } else if (wifiStats.state == NET_BACKOFF) {
+            long waitS = ((int32_t)(wifiStats.retryAtMs - millis()) + 999) / 1000;
+            snprintf(lines[1], sizeof(lines[1]), "Link: %s #%d %lds%s", wifiStateName(), wifiStats.attempts,
+                     waitS > 0 ? waitS : 0L, ap);
+        } else {
+            snprintf(lines[1], sizeof(lines[1]), "Link: %s%s", wifiStateName(), ap);
+        }
+        sprintf(lines[2], "STA SSID: %s", wifi_sta_ssid);
+        sprintf(lines[3], "STA Pass: %s", wifi_sta_pass); 
+        char ip[16];
+        fmtIPv4(ip, sizeof(ip), WiFi.localIP());
+        sprintf(lines[4], "STA IP: %s", ip);
         
-        sprintf(lines[4], "AP SSID: %s", wifi_ap_ssid);
-        sprintf(lines[5], "AP Pass: %s", wifi_ap_pass);
-        sprintf(lines[6], "AP IP: %s", WiFi.softAPIP().toString().c_str());
+        sprintf(lines[5], "AP SSID: %s", wifi_ap_ssid);
+        sprintf(lines[6], "AP Pass: %s", wifi_ap_pass);
+        fmtIPv4(ip, sizeof(ip), WiFi.softAPIP());
+        sprintf(lines[7], "AP IP: %s", ip);
         
-        int count = 7;
+        int count = 8;
         for (int i=0; i<maxLines; i++) {
-            int idx = i + pageScrollY;
+            int idx = i + ui.pageScroll;
             if (idx < count) {
                 u8g2.setCursor(0, 20 + (i*10));
                 u8g2.print(lines[idx]);
             }
         }
-    } else if (activePageId == 2) { 
+    } else if (ui.pageId == 2) { 
         u8g2.drawStr(0, 10, "   --- Status Logs ---");
-        int count = getLogCount();
+        uint32_t end = logEndSeq();
+        uint32_t first = logFirstSeq();
         for (int i=0; i<maxLines; i++) {
-            int idx = i + pageScrollY;
-            if (idx < count) {
-                u8g2.setCursor(0, 20 + (i*10));
-                u8g2.print(getLogLine(count - 1 - idx)); 
+            uint32_t back = i + ui.pageScroll + 1;
+            if (back > end - first) break;
+            uint32_t seq = end - back;
+            const LogRecord* r = logGet(seq);
+            char line[LOG_LINE_LEN];
+            if (r && logFormat(*r, line, sizeof(line)) > 0 && logValid(r, seq)) {
+                u8g2.drawStr(0, 20 + (i*10), line);
             }
         }
-    } else if (activePageId == 3) {
+    } else if (ui.pageId == 3) {
         u8g2.drawStr(0, 10, "      --- About ---");
         u8g2.drawStr(0, 20, "Omnibus 4X8 Power Bank");
         u8g2.drawStr(0, 30, "HW 1.0");
         u8g2.drawStr(0, 40, "FW 1.0.0");
+
+        const TaskTiming& ctl = taskTimings[TASK_CONTROL];
+        char loopStr[30];
+        sprintf(loopStr, "Ctl %lu/%luus", (unsigned long)ctl.maxRunUs, (unsigned long)ctl.maxLateUs);
+        u8g2.drawStr(0, 50, loopStr);
+
+        char powerStr[30];
+        unsigned long upMs = max(millis(), 1UL);
+        sprintf(powerStr, "Low %lu%% %s wake %luus", (unsigned long)((uint64_t)powerStats.lowPowerMs * 100 / upMs),
+                powerStats.lightSleep ? "LS" : "", (unsigned long)powerStats.wakeMaxUs);
+        u8g2.drawStr(0, 60, powerStr);
+    } else if (ui.pageId == 4) {
+        u8g2.drawStr(0, 10, "   --- Diagnostics ---");
+        u8g2.drawStr(0, 20, "      p99   max  over");
+        for (int i=0; i<maxLines-1; i++) {
+            int idx = i + ui.pageScroll;
+            char line[30];
+            if (idx == PROF_COUNT) {
+                snprintf(line, sizeof(line), "OLED %luB/s %lums", (unsigned long)displayStats.bytesPerSec,
+                         (unsigned long)displayStats.intervalMs);
+                u8g2.drawStr(0, 30 + (i*10), line);
+            } else if (idx == PROF_COUNT + 1) {
+                snprintf(line, sizeof(line), "Flip %lu/%luus drop %lu", (unsigned long)displayStats.flipLastUs,
+                         (unsigned long)displayStats.flipMaxUs, (unsigned long)displayStats.dropped);
+                u8g2.drawStr(0, 30 + (i*10), line);
+            } else if (idx == PROF_COUNT + 2) {
+                snprintf(line, sizeof(line), "Cfg %lu wr %luB %lu sav", (unsigned long)settingsStats.writes,
+                         (unsigned long)settingsStats.bytesWritten,
+                         (unsigned long)(settingsStats.coalesced + settingsStats.skipped));
+                u8g2.drawStr(0, 30 + (i*10), line);
+            } else if (idx == PROF_COUNT + 3) {
+                snprintf(line, sizeof(line), "Jnl #%u %lu wr %lu drop", journalStats.boot,
+                         (unsigned long)journalStats.written, (unsigned long)journalStats.dropped);
+                u8g2.drawStr(0, 30 + (i*10), line);
+            } else if (idx == PROF_COUNT + 4) {
+                snprintf(line, sizeof(line), "Str %s %dHz %lusk %lulost", streamActive() ? "on" : "off",
+                         streamRateHz(), (unsigned long)streamStats.skipped, (unsigned long)streamStats.lost);
+                u8g2.drawStr(0, 30 + (i*10), line);
+            } else if (idx == PROF_COUNT + 5) {
+                snprintf(line, sizeof(line), "Net %ld/%lddBm %lu drop", (long)(wifiStats.rssiAvg16 / 16),
+                         (long)wifiStats.rssiMin, (unsigned long)wifiStats.drops);
+                u8g2.drawStr(0, 30 + (i*10), line);
+            } else if (idx == PROF_COUNT + 6) {
+                char eff[FMT_MAX_LEN], wh[FMT_MAX_LEN];
+                if (mpptStats.sweepPmaxMw > 0) fmtFixed(eff, sizeof(eff), mpptStats.efficiencyPermille, DIAG_EFFICIENCY);
+                else snprintf(eff, sizeof(eff), "--");
+                fmtFixed(wh, sizeof(wh), (int32_t)mpptStats.harvestedMwh, DIAG_WATT_HOURS);
+                snprintf(line, sizeof(line), "MPPT %s %s %lusw", eff, wh, (unsigned long)mpptStats.sweeps);
+                u8g2.drawStr(0, 30 + (i*10), line);
+            } else if (idx >= PROF_COUNT + 7 && idx < PROF_COUNT + 7 + faultCount()) {
+                // latched faults, newest first
+                const FaultRecord* r = faultGet(idx - PROF_COUNT - 7);
+                snprintf(line, sizeof(line), "F %-8s%6ld %lu:%02lu", faultName(r->cause), (long)r->value,
+                         (unsigned long)(r->at / 60000), (unsigned long)(r->at / 1000 % 60));
+                u8g2.drawStr(0, 30 + (i*10), line);
+            }
+            if (idx >= PROF_COUNT) continue;
+            ProfilePoint p = (ProfilePoint)idx;
+            snprintf(line, sizeof(line), "%-5s%5lu%6lu%6lu", profName(p), (unsigned long)profPercentileUs(p, 990),
+                     (unsigned long)profHists[idx].maxUs, (unsigned long)profHists[idx].overruns);
+            u8g2.drawStr(0, 30 + (i*10), line);
+        }
     }
-    
-    u8g2.sendBuffer();
+}
+
+
+// Runs every display task tick: retire a finished flip, render when the
+// frame interval is up, flip whenever the bus is free.
+void displayService() {
+    updateByteRate();
+    if (flipInFlight && frameSpansSent == frameSpansQueued) finishFlip();
+
+    static unsigned long lastRender = 0;
+    unsigned long now = millis();
+    if (now - lastRender >= displayStats.intervalMs) {
+        lastRender = now;
+        if (framePending) {
+            // the previous frame is still waiting on the bus, skip this one
+            displayStats.dropped++;
+            displayStats.intervalMs = min((uint32_t)FRAME_MAX_MS, displayStats.intervalMs * 3 / 2);
+        } else {
+            UiSnapshot ui;
+            uiRead(ui);
+            TelemetrySnapshot t;
+            telemetryRead(t);
+
+            uint32_t t0 = profStart();
+            u8g2.clearBuffer();
+            if (ui.screen == 0) drawStatusScreen(ui, t);
+            else if (ui.screen == 1) drawMenu(ui);
+            else if (ui.screen == 2) drawPage(ui);
+            profEnd(PROF_DRAW, t0);
+            framePending = true;
+        }
+    }
+
+    if (framePending && !flipInFlight) flipFrame();
 }
 
 void displaySetup() {
-    u8g2.begin();
+    i2cRunSync(I2C_PRIO_DISPLAY, displayBeginJob);
     u8g2.setFont(u8g2_font_profont10_tf);
 }
\ No newline at end of file
@@ -5,9 +5,52 @@
 #include <U8g2lib.h>
 #include "config.h"
 
+// The display task renders into u8g2's buffer (the back buffer) from a
+// UiSnapshot, then flips: tiles that changed are copied into a front buffer
+// and streamed out by the I2C bus task. Rendering never touches the buffer
+// on the bus. The frame interval stretches while the bus is slow to drain.
+// Render time is profiled under PROF_DRAW.
+
+#define FRAME_MIN_MS 100
+#define FRAME_MAX_MS 500
+#define UI_ROWS 7
+
+struct UiRow {
+    const char* name;
+    char value[16];
+};
+
+// Everything the renderer needs from the menu side, published by the UI task
+// after each input pass. Rows hold the quick menu on the status screen and
+// the visible rows of a menu.
+struct UiSnapshot {
+    int screen;
+    int statusView;
+    int pageId;
+    int pageScroll;
+    int cursor;
+    int view;
+    bool editing;
+    bool apoEnabled;
+    bool apoCountingDown;
+    int fanPercent;
+    int rowCount;
+    UiRow rows[UI_ROWS];
+};
+
+struct DisplayStats {
+    uint32_t frames;        // flips sent to the panel
+    uint32_t dropped;       // renders skipped while the previous flip was on the bus
+    uint32_t intervalMs;
+    uint32_t flipLastUs;    // first span queued -> last span on the panel
+    uint32_t flipMaxUs;
+    uint32_t bytesPerSec;
+};
+
+extern DisplayStats displayStats;
+
 void displaySetup();
-void drawStatusScreen();
-void drawMenu();
-void drawPage();
+void uiPublish();
+void displayService();
 
-#endif
\ No newline at end of file
+#endif
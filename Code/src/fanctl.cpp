@@ -0,0 +1,75 @@
+#include "fanctl.h"
+
+int32_t fanZoneUpdate(FanZone& z, const FanZoneConfig& cfg, int32_t tempC100, uint32_t tempAtMs, bool stale,
+                      int32_t powerMw, uint32_t dtMs) {
+    // no reading, no control: run flat out until the sensor is back
+    if (stale) {
+        z.primed = false;
+        z.output = 1000;
+        return z.output;
+    }
+
+    int32_t band = max(cfg.maxC100 - cfg.minC100, (int32_t)100);
+    int32_t setpoint = cfg.minC100 + band / 2;
+
+    if (!z.primed || dtMs == 0) {
+        z.lastC100 = tempC100;
+        z.lastAtMs = tempAtMs;
+        z.rateC100s = 0;
+        z.primed = true;
+    } else if (tempAtMs != z.lastAtMs) {
+        // one quantisation step per reading is still a large raw rate, hence the smoothing
+        int32_t gap = (int32_t)(tempAtMs - z.lastAtMs);
+        int32_t rate = (tempC100 - z.lastC100) * 1000 / gap;
+        z.rateC100s += (int32_t)((int64_t)(rate - z.rateC100s) * gap / (gap + FAN_RATE_TAU_MS));
+        z.lastC100 = tempC100;
+        z.lastAtMs = tempAtMs;
+    }
+
+    if (tempC100 >= cfg.minC100) z.active = true;
+    else if (tempC100 < cfg.minC100 - FAN_HYST_C100) z.active = false;
+
+    int32_t ff = 0;
+    if (tempC100 > cfg.minC100 - FAN_FF_MARGIN_C100 && cfg.ffFullMw > 0) {
+        ff = (int32_t)min((int64_t)abs(powerMw) * 1000 / cfg.ffFullMw, (int64_t)FAN_FF_MAX);
+    }
+
+    if (!z.active) {
+        z.integral = 0;
+        z.output = ff;
+        return z.output;
+    }
+    if (tempC100 >= cfg.maxC100) {
+        z.output = 1000;
+        return z.output;
+    }
+
+    int32_t err = tempC100 - setpoint;
+    int32_t p = err * 1000 / band;
+    int32_t d = (int32_t)((int64_t)z.rateC100s * FAN_TD_MS / band);
+    int32_t out = 500 + p + z.integral / 1000 + d + ff;
+
+    // conditional integration: no winding further into a saturated output
+    if (!(out >= 1000 && err > 0) && !(out <= 0 && err < 0)) {
+        z.integral += (int32_t)((int64_t)err * 1000000 / band * dtMs / FAN_TI_MS);
+        z.integral = constrain(z.integral, (int32_t)-1000000, (int32_t)1000000);
+    }
+
+    z.output = constrain(out, (int32_t)0, (int32_t)1000);
+    return z.output;
+}
+
+int32_t fanSlew(int32_t current, int32_t target, uint32_t dtMs) {
+    int32_t up = max((int32_t)(FAN_SLEW_UP_PER_S * dtMs / 1000), (int32_t)1);
+    int32_t down = max((int32_t)(FAN_SLEW_DOWN_PER_S * dtMs / 1000), (int32_t)1);
+    if (target > current + up) return current + up;
+    if (target < current - down) return current - down;
+    return target;
+}
+
+// 0 stays off, anything else starts at the fan's minimum usable PWM
+int32_t fanDutyPermille(int32_t demand, int minPwmPercent) {
+    if (demand <= 0) return 0;
+    int32_t floor = minPwmPercent * 10;
+    return floor + (1000 - floor) * min(demand, (int32_t)1000) / 1000;
+}
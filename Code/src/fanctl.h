@@ -0,0 +1,51 @@
+#ifndef FANCTL_H
+#define FANCTL_H
+
+#include <Arduino.h>
+
+// Per-zone PID fan control. Each zone runs PID around the middle of its
+// min..max band, on top of the old linear curve as a bias, plus feed-forward
+// from the power flowing through it. The fan follows the hottest demand
+// through a slew limiter. No hardware access, so it runs unchanged on a host.
+// Outputs are in permille of the fan's usable range.
+
+#define FAN_TI_MS 60000          // integral time
+#define FAN_TD_MS 10000          // derivative time, on measurement
+#define FAN_RATE_TAU_MS 4000     // smoothing of the measured dT/dt
+#define FAN_HYST_C100 100        // zone switches off this far below its min
+#define FAN_FF_MARGIN_C100 500   // feed-forward starts this far below min
+#define FAN_FF_MAX 600
+#define FAN_SLEW_UP_PER_S 400
+#define FAN_SLEW_DOWN_PER_S 100
+
+enum FanZoneId {
+    FAN_ZONE_TBAT,
+    FAN_ZONE_TMOD,
+    FAN_ZONE_TINV,
+    FAN_ZONES
+};
+
+struct FanZoneConfig {
+    int32_t minC100;
+    int32_t maxC100;
+    int32_t ffFullMw;   // power whose feed-forward would be 1000, before the FAN_FF_MAX cap
+};
+
+struct FanZone {
+    int32_t integral;   // milli-permille
+    int32_t lastC100;
+    uint32_t lastAtMs;  // when lastC100 was read
+    int32_t rateC100s;  // filtered dT/dt, updated once per new reading
+    bool active;
+    bool primed;
+    int32_t output;     // last demand, permille
+};
+
+// tempAtMs: when the sensor produced tempC100. The DS18B20s only convert every
+// 0.5-1 s, so the rate is taken between readings, not per control tick.
+int32_t fanZoneUpdate(FanZone& z, const FanZoneConfig& cfg, int32_t tempC100, uint32_t tempAtMs, bool stale,
+                      int32_t powerMw, uint32_t dtMs);
+int32_t fanSlew(int32_t current, int32_t target, uint32_t dtMs);
+int32_t fanDutyPermille(int32_t demand, int minPwmPercent);
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef FIXEDPOINT_H
+#define FIXEDPOINT_H
+
+#include <Arduino.h>
+
+// The ESP32-C3 has no FPU, so telemetry is carried as integers:
+// mV, mA, mW, centi-degrees C and SOC in per-mille.
+// Floats only appear where user settings are read and where values are drawn.
+
+inline int32_t toMilli(float v) { return (int32_t)lroundf(v * 1000.0f); }
+inline int32_t toCenti(float v) { return (int32_t)lroundf(v * 100.0f); }
+inline float fromMilli(int32_t v) { return (float)v * 0.001f; }
+inline float fromCenti(int32_t v) { return (float)v * 0.01f; }
+
+// floor(sqrt(v)), bit by bit
+inline uint32_t isqrt64(uint64_t v) {
+    uint64_t root = 0;
+    uint64_t bit = 1ULL << 62;
+    while (bit > v) bit >>= 2;
+    while (bit != 0) {
+        if (v >= root + bit) {
+            v -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)root;
+}
+
+#endif
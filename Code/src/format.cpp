@@ -0,0 +1,45 @@
+#include "format.h"
+
+static const int32_t POW10[] = {1, 10, 100, 1000, 10000, 100000};
+
+int fmtFixed(char* out, size_t len, int32_t value, const FmtSpec& spec) {
+    if (len == 0) return 0;
+    int32_t div = spec.scale / POW10[spec.decimals];
+    uint32_t mag = value < 0 ? (uint32_t)(-(int64_t)value) : (uint32_t)value;
+    uint32_t q = (mag + div / 2) / div;
+
+    // built right to left: fraction, point, integer part, sign
+    char digits[14];
+    int n = 0;
+    bool negative = value < 0 && q != 0;
+    for (int i = 0; i < spec.decimals; i++) {
+        digits[n++] = '0' + q % 10;
+        q /= 10;
+    }
+    if (spec.decimals) digits[n++] = '.';
+    do {
+        digits[n++] = '0' + q % 10;
+        q /= 10;
+    } while (q);
+    if (negative) digits[n++] = '-';
+
+    size_t pos = 0;
+    for (int pad = spec.width - n; pad > 0 && pos + 1 < len; pad--) out[pos++] = ' ';
+    while (n > 0 && pos + 1 < len) out[pos++] = digits[--n];
+    for (const char* s = spec.suffix; s && *s && pos + 1 < len; s++) out[pos++] = *s;
+    out[pos] = '\0';
+    return pos;
+}
+
+const char* fmtCached(FmtCache& cache, int32_t value, const FmtSpec& spec) {
+    if (cache.spec != &spec || cache.value != value) {
+        fmtFixed(cache.text, sizeof(cache.text), value, spec);
+        cache.value = value;
+        cache.spec = &spec;
+    }
+    return cache.text;
+}
+
+int fmtIPv4(char* out, size_t len, const IPAddress& ip) {
+    return snprintf(out, len, "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+}
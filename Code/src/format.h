@@ -0,0 +1,38 @@
+#ifndef FORMAT_H
+#define FORMAT_H
+
+#include <Arduino.h>
+#include <IPAddress.h>
+
+// Allocation-free formatting of fixed-point values for the display. A spec
+// says how many input units make 1.0, how many decimals to show, the minimum
+// width of the number (right aligned, like printf) and a unit suffix.
+// Rounds half away from zero and never prints "-0".
+
+#define FMT_MAX_LEN 16
+
+struct FmtSpec {
+    int32_t scale;       // a power of ten, at least 10^decimals
+    uint8_t decimals;
+    uint8_t width;
+    const char* suffix;
+};
+
+const FmtSpec FMT_VOLTS = {1000, 2, 0, "V"};     // mV
+const FmtSpec FMT_AMPS = {1000, 2, 0, "A"};      // mA
+const FmtSpec FMT_WATTS = {1000, 0, 0, "W"};     // mW
+const FmtSpec FMT_PERCENT = {10, 0, 0, "%"};     // permille
+const FmtSpec FMT_CELSIUS = {100, 1, 0, "C"};    // centi-C
+
+// Remembers the last value and spec so unchanged values skip the formatting.
+struct FmtCache {
+    int32_t value;
+    const FmtSpec* spec;
+    char text[FMT_MAX_LEN];
+};
+
+int fmtFixed(char* out, size_t len, int32_t value, const FmtSpec& spec);
+const char* fmtCached(FmtCache& cache, int32_t value, const FmtSpec& spec);
+int fmtIPv4(char* out, size_t len, const IPAddress& ip);
+
+#endif
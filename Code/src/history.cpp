@@ -0,0 +1,92 @@
+#include "history.h"
+
+struct HistoryAccum {
+    int32_t sum[HIST_CHANNELS];
+    int16_t min[HIST_CHANNELS];
+    int16_t max[HIST_CHANNELS];
+    uint16_t n;
+};
+
+struct HistoryRing {
+    HistoryBucket* buckets;
+    uint16_t size;
+    uint16_t fold;    // lower-tier buckets per bucket (tier 0 closes on time)
+    uint32_t period;  // seconds per bucket
+    uint16_t head;    // next slot to write
+    uint16_t count;
+    HistoryAccum acc;
+};
+
+HistoryBucket history1s[600];
+HistoryBucket history1m[1440];
+HistoryBucket history15m[672];
+
+HistoryRing historyRings[HIST_TIERS] = {
+    {history1s, 600, 0, 1},
+    {history1m, 1440, 60, 60},
+    {history15m, 672, 15, 900}
+};
+
+unsigned long historyOpenedAt = 0;   // start of the open tier-0 bucket, on a fixed period grid
+bool historyStarted = false;
+
+static void accumAdd(HistoryAccum& acc, const int16_t* mins, const int16_t* maxs, const int16_t* avgs) {
+    for (int c = 0; c < HIST_CHANNELS; c++) {
+        if (acc.n == 0 || mins[c] < acc.min[c]) acc.min[c] = mins[c];
+        if (acc.n == 0 || maxs[c] > acc.max[c]) acc.max[c] = maxs[c];
+        acc.sum[c] = (acc.n == 0) ? avgs[c] : acc.sum[c] + avgs[c];
+    }
+    acc.n++;
+}
+
+static void closeBucket(int tier) {
+    HistoryRing& r = historyRings[tier];
+    if (r.acc.n == 0) return;
+
+    HistoryBucket& b = r.buckets[r.head];
+    for (int c = 0; c < HIST_CHANNELS; c++) {
+        b.min[c] = r.acc.min[c];
+        b.max[c] = r.acc.max[c];
+        b.avg[c] = (int16_t)(r.acc.sum[c] / r.acc.n);
+    }
+    r.head = (r.head + 1) % r.size;
+    if (r.count < r.size) r.count++;
+    r.acc.n = 0;
+
+    if (tier + 1 < HIST_TIERS) {
+        HistoryRing& next = historyRings[tier + 1];
+        accumAdd(next.acc, b.min, b.max, b.avg);
+        if (next.acc.n >= next.fold) closeBucket(tier + 1);
+    }
+}
+
+void historyRecord(const int16_t values[HIST_CHANNELS]) {
+    unsigned long now = millis();
+    const unsigned long periodMs = historyRings[0].period * 1000UL;
+    if (!historyStarted) {
+        historyOpenedAt = now;
+        historyStarted = true;
+    }
+    if (now - historyOpenedAt >= periodMs) {
+        closeBucket(0);
+        // advance by whole periods so bucket edges do not drift with the sample
+        // phase; periods with no samples at all are skipped, not recorded empty
+        historyOpenedAt += (now - historyOpenedAt) / periodMs * periodMs;
+    }
+
+    accumAdd(historyRings[0].acc, values, values, values);
+}
+
+int historyCount(HistoryTier tier) {
+    return historyRings[tier].count;
+}
+
+uint32_t historyPeriod(HistoryTier tier) {
+    return historyRings[tier].period;
+}
+
+const HistoryBucket* historyGet(HistoryTier tier, int age) {
+    const HistoryRing& r = historyRings[tier];
+    if (age < 0 || age >= r.count) return nullptr;
+    return &r.buckets[(r.head + r.size - 1 - age) % r.size];
+}
@@ -0,0 +1,36 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <Arduino.h>
+
+// Fixed-memory telemetry history. Each tier is a ring of min/max/avg buckets;
+// a closed bucket of one tier is folded into the open bucket of the next.
+// Everything is statically allocated: 2712 buckets x 24 bytes = ~64 KB.
+
+enum HistoryChannel {
+    HIST_VBAT,  // mV
+    HIST_IBAT,  // mA
+    HIST_PBUS,  // dW (0.1 W)
+    HIST_TEMP,  // centi-C, hottest fresh sensor
+    HIST_CHANNELS
+};
+
+enum HistoryTier {
+    HIST_TIER_1S,   // 1 s x 600 = 10 min
+    HIST_TIER_1M,   // 1 min x 1440 = 24 h
+    HIST_TIER_15M,  // 15 min x 672 = 7 days
+    HIST_TIERS
+};
+
+struct HistoryBucket {
+    int16_t min[HIST_CHANNELS];
+    int16_t max[HIST_CHANNELS];
+    int16_t avg[HIST_CHANNELS];
+};
+
+void historyRecord(const int16_t values[HIST_CHANNELS]);
+int historyCount(HistoryTier tier);
+uint32_t historyPeriod(HistoryTier tier); // seconds per bucket
+const HistoryBucket* historyGet(HistoryTier tier, int age); // age 0 = newest closed bucket
+
+#endif
@@ -0,0 +1,110 @@
+#include "i2cbus.h"
+#include <Wire.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+
+struct I2CJob {
+    I2CJobFunc run;
+    I2CDoneFunc done;
+    void* ctx;
+    uint32_t queuedAt;
+};
+
+struct I2CSyncJob {
+    I2CJobFunc run;
+    void* ctx;
+    SemaphoreHandle_t sem;
+    bool ok;
+};
+
+const int I2C_QUEUE_LEN = 12;
+
+I2CBusStats i2cStats = {};
+
+static QueueHandle_t jobQueues[I2C_PRIO_COUNT];
+static TaskHandle_t busTask = nullptr;
+
+static void runJob(int prio, I2CJob& job) {
+    uint32_t start = micros();
+    uint32_t wait = start - job.queuedAt;
+    if (wait > i2cStats.maxWaitUs[prio]) i2cStats.maxWaitUs[prio] = wait;
+
+    bool ok = job.run(job.ctx);
+
+    uint32_t run = micros() - start;
+    if (run > i2cStats.maxRunUs[prio]) i2cStats.maxRunUs[prio] = run;
+    if (ok) i2cStats.completed[prio]++;
+    else i2cStats.failed[prio]++;
+
+    if (job.done) job.done(job.ctx, ok);
+}
+
+static void busWorker(void* arg) {
+    I2CJob job;
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // rescan from the top after every job so a queued display frame
+        // yields to telemetry between chunks
+        bool found = true;
+        while (found) {
+            found = false;
+            for (int p = 0; p < I2C_PRIO_COUNT; p++) {
+                if (xQueueReceive(jobQueues[p], &job, 0) == pdTRUE) {
+                    runJob(p, job);
+                    found = true;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+void i2cBusSetup(int sda, int scl) {
+    Wire.begin(sda, scl);
+    for (int p = 0; p < I2C_PRIO_COUNT; p++) {
+        jobQueues[p] = xQueueCreate(I2C_QUEUE_LEN, sizeof(I2CJob));
+    }
+    xTaskCreate(busWorker, "i2cbus", 4096, nullptr, 2, &busTask);
+}
+
+bool i2cSubmit(I2CPriority prio, I2CJobFunc run, I2CDoneFunc done, void* ctx) {
+    if (!busTask) return false;
+
+    I2CJob job = {run, done, ctx, (uint32_t)micros()};
+    if (xQueueSend(jobQueues[prio], &job, 0) != pdTRUE) {
+        i2cStats.rejected[prio]++;
+        return false;
+    }
+    xTaskNotifyGive(busTask);
+    return true;
+}
+
+static bool syncRun(void* ctx) {
+    I2CSyncJob* s = (I2CSyncJob*)ctx;
+    return s->run(s->ctx);
+}
+
+static void syncDone(void* ctx, bool ok) {
+    I2CSyncJob* s = (I2CSyncJob*)ctx;
+    s->ok = ok;
+    xSemaphoreGive(s->sem);
+}
+
+bool i2cRunSync(I2CPriority prio, I2CJobFunc run, void* ctx) {
+    // before setup, or already on the bus task: the bus is ours
+    if (!busTask || xTaskGetCurrentTaskHandle() == busTask) return run(ctx);
+
+    StaticSemaphore_t semBuf;
+    I2CSyncJob s = {run, ctx, xSemaphoreCreateBinaryStatic(&semBuf), false};
+    if (!i2cSubmit(prio, syncRun, syncDone, &s)) return false;
+    xSemaphoreTake(s.sem, portMAX_DELAY);
+    return s.ok;
+}
+
+int i2cPending(I2CPriority prio) {
+    if (!busTask) return 0;
+    return uxQueueMessagesWaiting(jobQueues[prio]);
+}
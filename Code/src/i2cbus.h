@@ -0,0 +1,36 @@
+#ifndef I2CBUS_H
+#define I2CBUS_H
+
+#include <Arduino.h>
+
+// All traffic on the shared SDA/SCL bus (INA219, SC8812A, OLED) is queued here
+// and executed by a single worker task, so loop() never waits on the bus.
+// A job's run function owns the bus exclusively while it executes; keep each
+// job to one short transfer so higher priority work can slot in between.
+
+enum I2CPriority {
+    I2C_PRIO_CONTROL,   // converter configuration
+    I2C_PRIO_SENSOR,    // periodic telemetry reads
+    I2C_PRIO_DISPLAY,   // OLED frame chunks
+    I2C_PRIO_COUNT
+};
+
+typedef bool (*I2CJobFunc)(void* ctx);
+typedef void (*I2CDoneFunc)(void* ctx, bool ok);
+
+struct I2CBusStats {
+    uint32_t completed[I2C_PRIO_COUNT];
+    uint32_t failed[I2C_PRIO_COUNT];
+    uint32_t rejected[I2C_PRIO_COUNT];  // queue full
+    uint32_t maxWaitUs[I2C_PRIO_COUNT]; // submit -> start
+    uint32_t maxRunUs[I2C_PRIO_COUNT];
+};
+
+extern I2CBusStats i2cStats;
+
+void i2cBusSetup(int sda, int scl);
+bool i2cSubmit(I2CPriority prio, I2CJobFunc run, I2CDoneFunc done = nullptr, void* ctx = nullptr);
+bool i2cRunSync(I2CPriority prio, I2CJobFunc run, void* ctx = nullptr);
+int i2cPending(I2CPriority prio);
+
+#endif
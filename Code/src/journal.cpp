@@ -0,0 +1,205 @@
+#include "journal.h"
+#include "crc32.h"
+#include <esp_partition.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+#define SEGMENT_MAGIC 0x314E524A  // "JRN1"
+#define RECORD_MAGIC 0x4A52
+
+const int SLOTS = JOURNAL_SEGMENT_SIZE / sizeof(JournalRecord);  // slot 0 holds the header
+
+struct SegmentHeader {
+    uint32_t magic;
+    uint32_t seq;
+    uint32_t crc;
+};
+
+JournalStats journalStats;
+
+const esp_partition_t* journalPart = nullptr;
+SemaphoreHandle_t journalMutex = nullptr;
+uint16_t tailSegment = 0;
+uint16_t tailSlot = 1;
+uint32_t tailSeq = 0;
+
+JournalRecord stage[JOURNAL_STAGE_SIZE];
+volatile uint32_t stageHead = 0;   // written by loggers
+volatile uint32_t stageTail = 0;   // written by the flusher
+portMUX_TYPE stageMux = portMUX_INITIALIZER_UNLOCKED;
+
+static uint32_t slotOffset(int segment, int slot) {
+    return (uint32_t)segment * JOURNAL_SEGMENT_SIZE + slot * sizeof(JournalRecord);
+}
+
+static bool readHeader(int segment, SegmentHeader& h) {
+    if (esp_partition_read(journalPart, slotOffset(segment, 0), &h, sizeof(h)) != ESP_OK) return false;
+    return h.magic == SEGMENT_MAGIC && h.crc == crc32(&h, offsetof(SegmentHeader, crc));
+}
+
+static bool slotErased(int segment, int slot) {
+    uint16_t magic;
+    esp_partition_read(journalPart, slotOffset(segment, slot), &magic, sizeof(magic));
+    return magic == 0xFFFF;
+}
+
+static bool readRecord(int segment, int slot, JournalRecord& rec) {
+    if (esp_partition_read(journalPart, slotOffset(segment, slot), &rec, sizeof(rec)) != ESP_OK) return false;
+    return rec.magic == RECORD_MAGIC && rec.crc == crc32(&rec, offsetof(JournalRecord, crc));
+}
+
+static void startSegment(int segment, uint32_t seq) {
+    esp_partition_erase_range(journalPart, slotOffset(segment, 0), JOURNAL_SEGMENT_SIZE);
+    SegmentHeader h = {SEGMENT_MAGIC, seq, 0};
+    h.crc = crc32(&h, offsetof(SegmentHeader, crc));
+    esp_partition_write(journalPart, slotOffset(segment, 0), &h, sizeof(h));
+    tailSegment = segment;
+    tailSlot = 1;
+    tailSeq = seq;
+}
+
+// newest valid record before the tail, to carry the boot counter on
+static uint16_t lastBoot() {
+    JournalRecord rec;
+    for (int back = 0; back < 2; back++) {
+        int segment = (tailSegment + journalStats.segments - back) % journalStats.segments;
+        SegmentHeader h;
+        if (!readHeader(segment, h) || (back && h.seq + 1 != tailSeq)) break;
+        for (int slot = back ? SLOTS - 1 : tailSlot - 1; slot >= 1; slot--) {
+            if (readRecord(segment, slot, rec)) return rec.boot;
+        }
+    }
+    return 0;
+}
+
+void journalSetup() {
+    uint32_t start = micros();
+    journalMutex = xSemaphoreCreateMutex();
+    journalPart = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "journal");
+    if (!journalPart) return; // old partition table, run without a journal
+    journalStats.segments = journalPart->size / JOURNAL_SEGMENT_SIZE;
+
+    bool found = false;
+    for (int s = 0; s < journalStats.segments; s++) {
+        SegmentHeader h;
+        if (readHeader(s, h) && (!found || (int32_t)(h.seq - tailSeq) > 0)) {
+            tailSegment = s;
+            tailSeq = h.seq;
+            found = true;
+        }
+    }
+
+    if (!found) {
+        startSegment(0, 1);
+    } else {
+        // slots fill in order, so the first erased one is found by bisection;
+        // a torn record from a power cut reads as used and is skipped later
+        int lo = 1, hi = SLOTS;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (slotErased(tailSegment, mid)) hi = mid;
+            else lo = mid + 1;
+        }
+        tailSlot = lo;
+    }
+
+    journalStats.boot = lastBoot() + 1;
+    journalStats.ready = true;
+    journalStats.scanUs = micros() - start;
+}
+
+void journalAppend(const LogRecord& r) {
+    if (!journalStats.ready) return;
+    JournalRecord rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.magic = RECORD_MAGIC;
+    rec.code = r.code;
+    rec.severity = r.severity;
+    rec.boot = journalStats.boot;
+    rec.flags = r.flags;
+    rec.atMs = r.atMs;
+    memcpy(rec.args, r.args, sizeof(rec.args));
+    if (r.text) strncpy(rec.text, r.text, sizeof(rec.text) - 1);
+    rec.crc = crc32(&rec, offsetof(JournalRecord, crc));
+
+    portENTER_CRITICAL(&stageMux);
+    if (stageHead - stageTail < JOURNAL_STAGE_SIZE) {
+        stage[stageHead % JOURNAL_STAGE_SIZE] = rec;
+        stageHead++;
+    } else {
+        journalStats.dropped++;
+    }
+    portEXIT_CRITICAL(&stageMux);
+}
+
+static void writeStaged() {
+    while (stageTail != stageHead) {
+        if (tailSlot >= SLOTS) {
+            startSegment((tailSegment + 1) % journalStats.segments, tailSeq + 1);
+            journalStats.rotations++;
+        }
+        esp_partition_write(journalPart, slotOffset(tailSegment, tailSlot), &stage[stageTail % JOURNAL_STAGE_SIZE],
+                            sizeof(JournalRecord));
+        tailSlot++;
+        stageTail++;
+        journalStats.written++;
+    }
+}
+
+void journalService() {
+    if (!journalStats.ready || stageTail == stageHead) return;
+    xSemaphoreTake(journalMutex, portMAX_DELAY);
+    writeStaged();
+    xSemaphoreGive(journalMutex);
+}
+
+// same drain, named for the call sites that must not lose anything
+void journalFlush() {
+    journalService();
+}
+
+void journalBegin(JournalCursor& c) {
+    // the segment after the tail is the oldest, once the ring has wrapped
+    c.segment = journalStats.segments ? (tailSegment + 1) % journalStats.segments : 0;
+    c.slot = 1;
+    c.visited = 0;
+}
+
+bool journalNext(JournalCursor& c, JournalRecord& rec) {
+    if (!journalStats.ready) return false;
+    xSemaphoreTake(journalMutex, portMAX_DELAY);
+    bool got = false;
+    while (!got && c.visited < journalStats.segments) {
+        SegmentHeader h;
+        int end = c.segment == tailSegment ? tailSlot : SLOTS;
+        if (c.slot == 1 && !readHeader(c.segment, h)) end = 0; // never used
+        if (c.slot < end) {
+            got = readRecord(c.segment, c.slot, rec); // a torn record fails its CRC and is skipped
+            c.slot++;
+            continue;
+        }
+        c.segment = (c.segment + 1) % journalStats.segments;
+        c.slot = 1;
+        c.visited++;
+    }
+    xSemaphoreGive(journalMutex);
+    return got;
+}
+
+void journalDump(Print& out) {
+    JournalCursor c;
+    journalBegin(c);
+    JournalRecord rec;
+    char line[LOG_LINE_LEN];
+    while (journalNext(c, rec)) {
+        LogRecord r;
+        r.atMs = rec.atMs;
+        r.severity = rec.severity;
+        r.code = rec.code;
+        r.flags = 0;
+        r.text = rec.text;
+        memcpy(r.args, rec.args, sizeof(r.args));
+        logFormat(r, line, sizeof(line));
+        out.printf("#%u %s\n", rec.boot, line);
+    }
+}
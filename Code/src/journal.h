@@ -0,0 +1,61 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <Arduino.h>
+#include "statuslog.h"
+
+// Append-only event journal in the "journal" flash partition, so the status
+// log and faults survive reboots. The partition is split into 4 KB segments
+// used round-robin (erased just before reuse, which spreads the wear). Each
+// segment starts with a header carrying an increasing sequence number,
+// followed by fixed-size CRC-framed records. Boot finds the tail from the
+// segment headers and a binary search for the first erased slot.
+// logEvent() stages records in RAM without blocking; the network task
+// writes them out, and journalFlush() drains before a restart or sleep.
+
+#define JOURNAL_SEGMENT_SIZE 4096
+#define JOURNAL_STAGE_SIZE 16
+#define JOURNAL_TEXT_LEN 20
+
+struct JournalRecord {
+    uint16_t magic;      // 0xFFFF in an erased slot
+    uint8_t code;
+    uint8_t severity;
+    uint16_t boot;
+    uint8_t flags;
+    uint8_t reserved;
+    uint32_t atMs;
+    int32_t args[3];
+    char text[JOURNAL_TEXT_LEN];
+    uint32_t crc;        // over everything above
+};
+
+struct JournalStats {
+    bool ready;
+    uint16_t boot;
+    uint16_t segments;
+    uint32_t scanUs;     // boot-time tail scan
+    uint32_t written;
+    uint32_t dropped;    // staging buffer full
+    uint32_t rotations;
+};
+
+struct JournalCursor {
+    uint16_t segment;
+    uint16_t slot;
+    uint16_t visited;
+};
+
+extern JournalStats journalStats;
+
+void journalSetup();
+void journalAppend(const LogRecord& r);
+void journalService();
+void journalFlush();
+
+// oldest to newest across all segments
+void journalBegin(JournalCursor& c);
+bool journalNext(JournalCursor& c, JournalRecord& rec);
+void journalDump(Print& out);
+
+#endif
@@ -2,36 +2,36 @@
 #include "config.h"
 #include "display.h"
 #include "system.h"
+#include "tasks.h"
+#include "resume.h"
+#include "statuslog.h"
+#include "journal.h"
+#include "bench.h"
+#include "telemstream.h"
 
 void setup() {
+    Serial.setTxBufferSize(STREAM_SERIAL_TX_BUFFER); // must precede begin()
     Serial.begin(115200);
+    resumeCheck();
+    journalSetup();
+    bootMark("journal");
     configSetup();
+    resumeRestore();
+    bootMark("config");
     systemSetup();
+    bootMark("system");
     displaySetup();
-    logStatus("System Booted");
+    bootMark("display");
+    logEvent(LOG_INFO, EV_BOOTED, resumeIsWarm());
+#ifdef FIXEDPOINT_BENCH
+    runFixedPointBenchmark();
+#endif
+    tasksStart();
+    bootMark("sensors");
+    bootReport();
 }
 
+// everything runs on the tasks started above
 void loop() {
-    static unsigned long t50 = 0;
-    static unsigned long t100 = 0;
-    unsigned long now = millis();
-    
-    if (now - t50 >= 20) {
-        t50 = now;
-        readButtons();
-        handleMenuLogic();
-    }
-    
-    if (now - t100 >= 100) {
-        t100 = now;
-        readSensors();
-        handleMPPT();
-        handleNetwork();
-        handleAutoPowerOff();
-        handleFanControl();
-        
-        if (screenSelect == 0) drawStatusScreen();
-        else if (screenSelect == 1) drawMenu();
-        else if (screenSelect == 2) drawPage();
-    }
-}
\ No newline at end of file
+    vTaskDelete(NULL);
+}
@@ -0,0 +1,149 @@
+#include "mppt.h"
+
+MpptStats mpptStats = {};
+
+MpptState mppt = {};
+unsigned long mpptLastStep = 0;
+unsigned long mpptLastSweep = 0;
+unsigned long mpptLastSample = 0;
+uint64_t mpptEnergyMwMs = 0;
+
+bool mpptSweepActive = false;
+bool mpptSweepDue = false;
+int mpptSweepPoint = 0;
+int32_t mpptSweepBestMw = 0;
+int32_t mpptSweepBestMv = 0;
+
+static int32_t perturbObserve(MpptState& s, int32_t vMv, int32_t iMa, int32_t pMw, const MpptConfig& cfg) {
+    if (pMw < s.lastPMw) s.dir = -s.dir;
+    return s.targetMv + s.dir * cfg.stepMv;
+}
+
+// step proportional to |dP/dV| / I, which is ~1 far from the MPP and ~0 at it
+static int32_t perturbObserveAdaptive(MpptState& s, int32_t vMv, int32_t iMa, int32_t pMw, const MpptConfig& cfg) {
+    if (pMw < s.lastPMw) s.dir = -s.dir;
+
+    int32_t dV = abs(vMv - s.lastVMv);
+    int32_t dP = abs(pMw - s.lastPMw);
+    int32_t step = cfg.stepMv;
+    if (dV > MPPT_DV_TOL_MV && iMa > 0) {
+        step = (int32_t)((int64_t)cfg.stepMv * dP * 1000 / ((int64_t)dV * iMa));
+    }
+    step = constrain(step, (int32_t)MPPT_MIN_STEP_MV, max(cfg.stepMv, (int32_t)MPPT_MIN_STEP_MV));
+    return s.targetMv + s.dir * step;
+}
+
+// dP/dV = I + V * dI/dV, so its sign is sign(I*dV + V*dI) * sign(dV)
+static int32_t incrementalConductance(MpptState& s, int32_t vMv, int32_t iMa, int32_t pMw, const MpptConfig& cfg) {
+    int32_t dV = vMv - s.lastVMv;
+    int32_t dI = iMa - s.lastIMa;
+
+    if (abs(dV) <= MPPT_DV_TOL_MV) {
+        if (abs(dI) <= MPPT_DI_TOL_MA) return s.targetMv;
+        s.dir = (dI > 0) ? 1 : -1;
+    } else {
+        int64_t slope = (int64_t)iMa * dV + (int64_t)vMv * dI;
+        if (dV < 0) slope = -slope;
+        // within 2% of I counts as sitting on the MPP
+        if ((slope < 0 ? -slope : slope) * 50 <= (int64_t)iMa * abs(dV)) return s.targetMv;
+        s.dir = (slope > 0) ? 1 : -1;
+    }
+    return s.targetMv + s.dir * cfg.stepMv;
+}
+
+const MpptStrategy mpptStrategies[MPPT_ALGORITHMS] = {
+    {"P&O", perturbObserve},
+    {"A-P&O", perturbObserveAdaptive},
+    {"INC", incrementalConductance}
+};
+
+static int32_t sweepTarget(const MpptConfig& cfg, int point) {
+    return cfg.maxMv - (cfg.maxMv - cfg.minMv) * point / (MPPT_SWEEP_POINTS - 1);
+}
+
+static void restartTracking(int32_t fromMv) {
+    mppt.targetMv = fromMv;
+    mppt.dir = 1;
+    mppt.primed = false;
+}
+
+void mpptReset(const MpptConfig& cfg, unsigned long now) {
+    restartTracking(constrain(cfg.startMv, cfg.minMv, cfg.maxMv));
+    mpptLastStep = now;
+    mpptLastSweep = now;
+    mpptLastSample = now;
+    mpptSweepActive = false;
+    mpptSweepDue = (cfg.sweepEveryMs > 0);
+}
+
+bool mpptUpdate(const MpptConfig& cfg, int32_t vMv, int32_t iMa, unsigned long now, int32_t& targetMv) {
+    int32_t pMw = vMv * iMa / 1000;
+
+    mpptEnergyMwMs += (uint64_t)max(pMw, (int32_t)0) * (now - mpptLastSample);
+    mpptLastSample = now;
+    mpptStats.harvestedMwh = (uint32_t)(mpptEnergyMwMs / 3600000ULL);
+
+    if (mpptSweepActive) {
+        if (pMw > mpptSweepBestMw) {
+            mpptSweepBestMw = pMw;
+            mpptSweepBestMv = mppt.targetMv;
+        }
+        if (++mpptSweepPoint < MPPT_SWEEP_POINTS) {
+            mppt.targetMv = sweepTarget(cfg, mpptSweepPoint);
+        } else {
+            mpptSweepActive = false;
+            mpptLastSweep = now;
+            mpptLastStep = now;
+            mpptStats.sweeps++;
+            mpptStats.sweepPmaxMw = mpptSweepBestMw;
+            mpptStats.sweepVmpMv = mpptSweepBestMv;
+            restartTracking(mpptSweepBestMv);
+        }
+        targetMv = mppt.targetMv;
+        return true;
+    }
+
+    if (mpptSweepDue || (cfg.sweepEveryMs > 0 && now - mpptLastSweep >= cfg.sweepEveryMs)) {
+        mpptSweepDue = false;
+        mpptSweepActive = true;
+        mpptSweepPoint = 0;
+        mpptSweepBestMw = -1;
+        mpptSweepBestMv = mppt.targetMv;
+        mppt.targetMv = sweepTarget(cfg, 0);
+        targetMv = mppt.targetMv;
+        return true;
+    }
+
+    if (now - mpptLastStep < cfg.intervalMs) return false;
+    mpptLastStep = now;
+
+    if (mpptStats.sweepPmaxMw > 0) {
+        int32_t eff = constrain(pMw * 1000 / mpptStats.sweepPmaxMw, (int32_t)0, (int32_t)1000);
+        mpptStats.efficiencyPermille += (eff - mpptStats.efficiencyPermille) / 8;
+    }
+
+    int32_t next;
+    if (!mppt.primed) {
+        next = mppt.targetMv + mppt.dir * cfg.stepMv;
+        mppt.primed = true;
+    } else {
+        int algo = constrain(cfg.algorithm, 0, MPPT_ALGORITHMS - 1);
+        next = mpptStrategies[algo].step(mppt, vMv, iMa, pMw, cfg);
+    }
+    mppt.lastVMv = vMv;
+    mppt.lastIMa = iMa;
+    mppt.lastPMw = pMw;
+
+    if (next < cfg.minMv || next > cfg.maxMv) {
+        mppt.dir = -mppt.dir; // bounce off the configured window
+        next = constrain(next, cfg.minMv, cfg.maxMv);
+    }
+    if (next == mppt.targetMv) return false;
+    mppt.targetMv = next;
+    targetMv = next;
+    return true;
+}
+
+bool mpptSweeping() {
+    return mpptSweepActive;
+}
@@ -0,0 +1,62 @@
+#ifndef MPPT_H
+#define MPPT_H
+
+#include <Arduino.h>
+
+// MPPT engine. The tracking step is a pluggable strategy; on top of it a
+// periodic sweep walks the VINREG setpoint from max to min so tracking can
+// restart from the global maximum when partial shading leaves several peaks.
+// Pure logic: the caller feeds settled VBUS/IBUS pairs and applies the target.
+
+#define MPPT_MIN_STEP_MV 100   // VINREG resolution above 10.24 V
+#define MPPT_SWEEP_POINTS 16
+#define MPPT_DV_TOL_MV 20      // ADC noise floor for incremental conductance
+#define MPPT_DI_TOL_MA 10
+
+enum MpptAlgorithm {
+    MPPT_PO,           // fixed-step perturb and observe
+    MPPT_PO_ADAPTIVE,  // step scaled by |dP/dV|
+    MPPT_INCCOND,      // incremental conductance
+    MPPT_ALGORITHMS
+};
+
+struct MpptConfig {
+    int32_t minMv;
+    int32_t maxMv;
+    int32_t startMv;
+    int32_t stepMv;
+    uint32_t intervalMs;
+    uint32_t sweepEveryMs;  // 0 = never sweep
+    int algorithm;
+};
+
+struct MpptState {
+    int32_t targetMv;
+    int32_t lastVMv;
+    int32_t lastIMa;
+    int32_t lastPMw;
+    int8_t dir;
+    bool primed;
+};
+
+struct MpptStrategy {
+    const char* name;
+    int32_t (*step)(MpptState& s, int32_t vMv, int32_t iMa, int32_t pMw, const MpptConfig& cfg); // next target
+};
+
+struct MpptStats {
+    uint32_t sweeps;
+    int32_t sweepPmaxMw;        // best power seen by the last sweep
+    int32_t sweepVmpMv;         // setpoint it was seen at
+    int32_t efficiencyPermille; // tracked power against sweepPmaxMw, slow average
+    uint32_t harvestedMwh;
+};
+
+extern const MpptStrategy mpptStrategies[MPPT_ALGORITHMS];
+extern MpptStats mpptStats;
+
+void mpptReset(const MpptConfig& cfg, unsigned long now);
+bool mpptUpdate(const MpptConfig& cfg, int32_t vMv, int32_t iMa, unsigned long now, int32_t& targetMv);
+bool mpptSweeping();
+
+#endif
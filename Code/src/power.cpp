@@ -0,0 +1,78 @@
+#include "power.h"
+#include "system.h"
+#include <esp_pm.h>
+#include <esp_sleep.h>
+#include <driver/gpio.h>
+
+PowerStats powerStats = {};
+
+volatile unsigned long lastActivity = 0;
+bool pmConfigured = false;
+esp_pm_lock_handle_t cpuMaxLock = nullptr;
+esp_pm_lock_handle_t noSleepLock = nullptr;
+bool noSleepHeld = false;
+
+void powerSetup() {
+    const int buttons[3] = {UP_PIN, ENTER_PIN, DOWN_PIN};
+    for (int i = 0; i < 3; i++) gpio_wakeup_enable((gpio_num_t)buttons[i], GPIO_INTR_LOW_LEVEL);
+    esp_sleep_enable_gpio_wakeup();
+
+#if CONFIG_PM_ENABLE
+    esp_pm_config_esp32c3_t cfg;
+    cfg.max_freq_mhz = POWER_MAX_MHZ;
+    cfg.min_freq_mhz = POWER_MIN_MHZ;
+#if CONFIG_FREERTOS_USE_TICKLESS_IDLE
+    cfg.light_sleep_enable = true;
+#else
+    cfg.light_sleep_enable = false;
+#endif
+    if (esp_pm_configure(&cfg) == ESP_OK &&
+        esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "active", &cpuMaxLock) == ESP_OK &&
+        esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "fanpwm", &noSleepLock) == ESP_OK) {
+        pmConfigured = true;
+        powerStats.lightSleep = cfg.light_sleep_enable;
+        esp_pm_lock_acquire(cpuMaxLock);
+    }
+#endif
+    lastActivity = millis();
+}
+
+void powerNoteActivity() {
+    lastActivity = millis();
+}
+
+static void setLowPower(bool low) {
+    if (low == powerStats.lowPower) return;
+    powerStats.lowPower = low;
+    if (pmConfigured) {
+        if (low) esp_pm_lock_release(cpuMaxLock);
+        else esp_pm_lock_acquire(cpuMaxLock);
+    } else {
+        setCpuFrequencyMhz(low ? POWER_MIN_MHZ : POWER_MAX_MHZ);
+    }
+}
+
+// called from the control task every tick
+void powerUpdate(bool fanRunning) {
+    static unsigned long lastRun = 0;
+    unsigned long now = millis();
+    uint32_t dt = (lastRun == 0) ? 0 : now - lastRun;
+    lastRun = now;
+
+    bool active = (now - lastActivity < POWER_ACTIVE_HOLD_MS) || screenSelect != 0;
+    setLowPower(!active);
+    if (powerStats.lowPower) powerStats.lowPowerMs += dt;
+
+    // LEDC stops in light sleep, so the fan holds the chip awake while it runs
+    if (pmConfigured && fanRunning != noSleepHeld) {
+        if (fanRunning) esp_pm_lock_acquire(noSleepLock);
+        else esp_pm_lock_release(noSleepLock);
+        noSleepHeld = fanRunning;
+    }
+}
+
+void powerRecordWake(uint32_t lateUs) {
+    if (!powerStats.lowPower) return;
+    powerStats.wakeLastUs = lateUs;
+    if (lateUs > powerStats.wakeMaxUs) powerStats.wakeMaxUs = lateUs;
+}
@@ -0,0 +1,32 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include <Arduino.h>
+
+// Power management. The CPU runs at POWER_MIN_MHZ until there is UI or
+// network activity. Where the core is built with power management, it also
+// light-sleeps between task ticks whenever the fan PWM is not running; the
+// buttons are wake sources. Stock arduino-esp32 ships with CONFIG_PM_ENABLE
+// off, so a normal build only switches the CPU clock; light sleep needs a
+// framework rebuilt with CONFIG_PM_ENABLE and CONFIG_FREERTOS_USE_TICKLESS_IDLE.
+
+#define POWER_MAX_MHZ 160
+#define POWER_MIN_MHZ 80
+#define POWER_ACTIVE_HOLD_MS 10000  // stay fast this long after the last activity
+
+struct PowerStats {
+    bool lowPower;          // currently in the reduced mode
+    bool lightSleep;        // automatic light sleep available in this build
+    uint32_t lowPowerMs;    // total time spent in the reduced mode
+    uint32_t wakeLastUs;    // control task release lateness in the reduced mode
+    uint32_t wakeMaxUs;
+};
+
+extern PowerStats powerStats;
+
+void powerSetup();
+void powerNoteActivity();
+void powerUpdate(bool fanRunning);
+void powerRecordWake(uint32_t lateUs);
+
+#endif
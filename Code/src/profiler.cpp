@@ -0,0 +1,77 @@
+#include "profiler.h"
+
+struct ProfileInfo {
+    const char* name;
+    uint32_t budgetUs;
+};
+
+static const ProfileInfo profInfo[PROF_COUNT] = {
+    {"SENS", 20000},
+    {"MPPT", 2000},
+    {"APO", 1000},
+    {"FAN", 1000},
+    {"NET", 20000},
+    {"DRAW", 30000},
+    {"WEB", 5000},
+    {"HTTP", 20000},
+    {"STRM", 5000},
+    {"L-CTL", 1000},
+    {"L-SNS", 5000},
+    {"L-UI", 10000},
+    {"L-DSP", 20000},
+    {"L-NET", 20000}
+};
+
+ProfileHist profHists[PROF_COUNT] = {};
+
+void profRecordUs(ProfilePoint p, uint32_t us) {
+    ProfileHist& h = profHists[p];
+    int b = (us == 0) ? 0 : 31 - __builtin_clz(us);
+    if (b >= PROF_BUCKETS) b = PROF_BUCKETS - 1;
+    h.buckets[b]++;
+    h.count++;
+    if (us > h.maxUs) h.maxUs = us;
+    if (us > profInfo[p].budgetUs) h.overruns++;
+}
+
+void profEnd(ProfilePoint p, uint32_t startUs) {
+    profRecordUs(p, micros() - startUs);
+}
+
+const char* profName(ProfilePoint p) {
+    return profInfo[p].name;
+}
+
+uint32_t profBudgetUs(ProfilePoint p) {
+    return profInfo[p].budgetUs;
+}
+
+// upper edge of the bucket holding the given rank, capped at the observed max
+uint32_t profPercentileUs(ProfilePoint p, int permille) {
+    const ProfileHist& h = profHists[p];
+    if (h.count == 0) return 0;
+    uint32_t rank = (uint32_t)((uint64_t)h.count * permille / 1000);
+    uint32_t seen = 0;
+    for (int b = 0; b < PROF_BUCKETS; b++) {
+        seen += h.buckets[b];
+        if (seen > rank) return min(h.maxUs, (uint32_t)((2UL << b) - 1));
+    }
+    return h.maxUs;
+}
+
+void profReset() {
+    memset(profHists, 0, sizeof(profHists));
+}
+
+void profDump(Print& out) {
+    out.println("point    count    p50us    p99us    maxus  budget  overruns");
+    char line[80];
+    for (int i = 0; i < PROF_COUNT; i++) {
+        ProfilePoint p = (ProfilePoint)i;
+        const ProfileHist& h = profHists[i];
+        snprintf(line, sizeof(line), "%-6s %7lu %8lu %8lu %8lu %7lu %9lu", profName(p),
+                 (unsigned long)h.count, (unsigned long)profPercentileUs(p, 500), (unsigned long)profPercentileUs(p, 990),
+                 (unsigned long)h.maxUs, (unsigned long)profBudgetUs(p), (unsigned long)h.overruns);
+        out.println(line);
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <Arduino.h>
+
+// Always-on handler timing. Each point keeps a log2 latency histogram
+// (bucket k holds [2^k, 2^(k+1)) us), its max and a count of budget overruns.
+// A point is only ever recorded from one task; readers tolerate a torn view.
+
+#define PROF_BUCKETS 20   // up to ~1 s
+
+enum ProfilePoint {
+    PROF_SENSORS,
+    PROF_MPPT,
+    PROF_APO,
+    PROF_FAN,
+    PROF_NETWORK,
+    PROF_DRAW,
+    PROF_WEB,             // SSE push, network task
+    PROF_HTTP,            // request handlers, AsyncTCP task
+    PROF_STREAM,          // binary telemetry framing and sends, network task
+    PROF_LATE_CONTROL,    // task release lateness
+    PROF_LATE_SENSING,
+    PROF_LATE_UI,
+    PROF_LATE_DISPLAY,
+    PROF_LATE_NETWORK,
+    PROF_COUNT
+};
+
+struct ProfileHist {
+    uint32_t count;
+    uint32_t maxUs;
+    uint32_t overruns;
+    uint32_t buckets[PROF_BUCKETS];
+};
+
+extern ProfileHist profHists[PROF_COUNT];
+
+// esp_timer microseconds rather than CPU cycles: the clock switches between
+// POWER_MAX_MHZ and POWER_MIN_MHZ and the cycle counter stops in light sleep
+inline uint32_t profStart() { return micros(); }
+void profEnd(ProfilePoint p, uint32_t startUs);
+void profRecordUs(ProfilePoint p, uint32_t us);
+
+const char* profName(ProfilePoint p);
+uint32_t profBudgetUs(ProfilePoint p);
+uint32_t profPercentileUs(ProfilePoint p, int permille);
+void profReset();
+void profDump(Print& out);
+
+#endif
@@ -0,0 +1,155 @@
+#include "protect.h"
+#include "system.h"
+#include "statuslog.h"
+#include <freertos/FreeRTOS.h>
+
+FaultRecord faultLog[FAULT_LOG_SIZE];
+uint32_t faultTotal = 0;
+volatile bool faultLatched = false;
+portMUX_TYPE faultMux = portMUX_INITIALIZER_UNLOCKED;
+
+ProtectState protectState = {};
+
+volatile bool simActive = false;
+volatile int32_t simIbatMa = 0;
+volatile int32_t simVbatMv = 0;
+
+static const char* faultNames[FAULT_CAUSES] = {"NONE", "OC-DSG", "OC-CHG", "OVERPWR", "OVERTEMP"};
+
+FaultCause protectEvaluate(ProtectState& st, int32_t ibatMa, int32_t vbatMv, bool saturated, int32_t& value) {
+    int32_t dischargeMa = -ibatMa;
+    int32_t powerMw = (int32_t)((int64_t)vbatMv * (ibatMa < 0 ? -ibatMa : ibatMa) / 1000);
+
+    st.dischargeOver = (dischargeMa > PROT_DISCHARGE_MA) ? st.dischargeOver + 1 : 0;
+    st.chargeOver = (ibatMa > PROT_CHARGE_MA) ? st.chargeOver + 1 : 0;
+    st.powerOver = (powerMw > PROT_POWER_MW) ? st.powerOver + 1 : 0;
+
+    if (saturated) {
+        value = ibatMa;
+        return ibatMa < 0 ? FAULT_OC_DISCHARGE : FAULT_OC_CHARGE;
+    }
+    if (st.dischargeOver >= PROT_DEBOUNCE_SAMPLES) {
+        value = dischargeMa;
+        return FAULT_OC_DISCHARGE;
+    }
+    if (st.chargeOver >= PROT_DEBOUNCE_SAMPLES) {
+        value = ibatMa;
+        return FAULT_OC_CHARGE;
+    }
+    if (st.powerOver >= PROT_DEBOUNCE_SAMPLES) {
+        value = powerMw;
+        return FAULT_OVERPOWER;
+    }
+    return FAULT_NONE;
+}
+
+// Outputs go first, bookkeeping after. Called from the bus task and the sensing
+// task. The pins are written under faultMux so protectSetOutputs() cannot slip
+// in between them and the latch.
+static void trip(FaultCause cause, uint8_t sensor, int32_t value, uint32_t sampledAtUs) {
+    portENTER_CRITICAL(&faultMux);
+    digitalWrite(EN_AC, LOW);
+    digitalWrite(EN_USB, LOW);
+    digitalWrite(PSTOP_PIN, HIGH);
+    uint32_t latency = micros() - sampledAtUs;
+    bool first = !faultLatched;
+    faultLatched = true;
+    if (first) {
+        FaultRecord& r = faultLog[faultTotal % FAULT_LOG_SIZE];
+        r.at = millis();
+        r.cause = cause;
+        r.sensor = sensor;
+        r.value = value;
+        r.latencyUs = latency;
+        faultTotal++;
+    }
+    portEXIT_CRITICAL(&faultMux);
+
+    qm_usb_out = false;
+    qm_ac_out = false;
+}
+
+void protectBatterySample(int32_t ibatMa, int32_t vbatMv, bool saturated, uint32_t sampledAtUs) {
+    if (faultLatched) return;
+    int32_t value = 0;
+    FaultCause cause = protectEvaluate(protectState, ibatMa, vbatMv, saturated, value);
+    if (cause != FAULT_NONE) trip(cause, 0, value, sampledAtUs);
+}
+
+// two readings in a row, so a stray 85.00 C power-on value cannot trip it
+void protectTemperature(int sensor, int32_t centi) {
+    static uint8_t over[4] = {0};
+    if (faultLatched || sensor < 0 || sensor >= 4) return;
+    int32_t limit = (sensor == 0) ? PROT_TBAT_C100 : PROT_TMOD_C100;
+    over[sensor] = (centi > limit) ? over[sensor] + 1 : 0;
+    if (over[sensor] >= PROT_DEBOUNCE_SAMPLES) trip(FAULT_OVERTEMP, (uint8_t)sensor, centi, micros());
+}
+
+// replaces the INA219 values on the protection path only, the ring still gets real samples
+void protectSimulate(bool enable, int32_t ibatMa, int32_t vbatMv) {
+    simIbatMa = ibatMa;
+    simVbatMv = vbatMv;
+    simActive = enable;
+}
+
+bool protectSimulating(int32_t& ibatMa, int32_t& vbatMv) {
+    if (!simActive) return false;
+    ibatMa = simIbatMa;
+    vbatMv = simVbatMv;
+    return true;
+}
+
+bool protectTripped() {
+    return faultLatched;
+}
+
+void protectSetOutputs(bool usb, bool ac) {
+    portENTER_CRITICAL(&faultMux);
+    if (faultLatched) usb = ac = false;
+    digitalWrite(EN_USB, usb);
+    digitalWrite(EN_AC, ac);
+    portEXIT_CRITICAL(&faultMux);
+    if (!usb) qm_usb_out = false;
+    if (!ac) qm_ac_out = false;
+}
+
+void protectClear() {
+    portENTER_CRITICAL(&faultMux);
+    protectState = ProtectState();
+    faultLatched = false;
+    portEXIT_CRITICAL(&faultMux);
+}
+
+int faultCount() {
+    return (int)min(faultTotal, (uint32_t)FAULT_LOG_SIZE);
+}
+
+const FaultRecord* faultGet(int age) {
+    if (age < 0 || age >= faultCount()) return nullptr;
+    return &faultLog[(faultTotal - 1 - age) % FAULT_LOG_SIZE];
+}
+
+const char* faultName(uint8_t cause) {
+    return cause < FAULT_CAUSES ? faultNames[cause] : "?";
+}
+
+void faultDump(Print& out) {
+    out.printf("Faults: %lu total%s\n", (unsigned long)faultTotal, faultLatched ? ", latched" : "");
+    for (int age = 0; age < faultCount(); age++) {
+        const FaultRecord* r = faultGet(age);
+        out.printf("  %lums %-8s %ld", (unsigned long)r->at, faultName(r->cause), (long)r->value);
+        if (r->cause == FAULT_OVERTEMP) out.printf(" sensor %u\n", r->sensor);
+        else out.printf(" cut %luus\n", (unsigned long)r->latencyUs);
+    }
+}
+
+// posts new faults to the status log, off the trip path
+void protectService() {
+    static uint32_t logged = 0;
+    while (logged < faultTotal) {
+        const FaultRecord& r = faultLog[logged % FAULT_LOG_SIZE];
+        int32_t detail = r.cause == FAULT_OVERTEMP ? r.sensor : (int32_t)r.latencyUs;
+        logEvent(LOG_FAULT, EV_FAULT, r.cause, r.value, detail);
+        logged++;
+    }
+}
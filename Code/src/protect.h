@@ -0,0 +1,65 @@
+#ifndef PROTECT_H
+#define PROTECT_H
+
+#include <Arduino.h>
+
+// Fast trip path. Every INA219 sample is checked on the bus task right after
+// it is read, and every DS18B20 reading as it arrives; a trip drops EN_AC and
+// EN_USB and raises PSTOP straight away, then latches until cleared.
+
+#define PROT_DISCHARGE_MA 30000      // XT60 path rating
+#define PROT_SHUNT_FULL_SCALE 16000  // shunt register at the INA219's +-160 mV range (gain 4)
+#define PROT_FULL_SCALE_MA 32000     // the same across 5 mOhm; a reading here trips at once
+#define PROT_CHARGE_MA 15000
+#define PROT_POWER_MW 500000         // 16.8 V x 30 A
+#define PROT_DEBOUNCE_SAMPLES 2      // consecutive samples over the sustained limits
+#define PROT_TBAT_C100 6500
+#define PROT_TMOD_C100 9500
+#define FAULT_LOG_SIZE 8
+
+enum FaultCause {
+    FAULT_NONE,
+    FAULT_OC_DISCHARGE,
+    FAULT_OC_CHARGE,
+    FAULT_OVERPOWER,
+    FAULT_OVERTEMP,
+    FAULT_CAUSES
+};
+
+struct FaultRecord {
+    uint32_t at;         // millis()
+    uint8_t cause;
+    uint8_t sensor;      // temperature channel for FAULT_OVERTEMP
+    int32_t value;       // mA, mW or centi-C
+    uint32_t latencyUs;  // sample in hand -> outputs off
+};
+
+struct ProtectState {
+    uint8_t dischargeOver;
+    uint8_t chargeOver;
+    uint8_t powerOver;
+};
+
+// Pure threshold logic, kept separate so it can be fed synthetic samples.
+// saturated: the shunt reading is clipped at full scale or the INA219 flagged
+// an overflow, so the real current is unknown but at least that high.
+FaultCause protectEvaluate(ProtectState& st, int32_t ibatMa, int32_t vbatMv, bool saturated, int32_t& value);
+
+void protectBatterySample(int32_t ibatMa, int32_t vbatMv, bool saturated, uint32_t sampledAtUs);
+void protectTemperature(int sensor, int32_t centi);
+// replaces the INA219 values on the protection path (serial command 's')
+void protectSimulate(bool enable, int32_t ibatMa = 0, int32_t vbatMv = 0);
+bool protectSimulating(int32_t& ibatMa, int32_t& vbatMv);
+
+void protectService();
+bool protectTripped();
+// drives EN_USB/EN_AC, both held low while a trip is latched; checked and
+// written under the same lock as the trip so one cannot undo the other
+void protectSetOutputs(bool usb, bool ac);
+void protectClear();
+int faultCount();
+const FaultRecord* faultGet(int age);  // age 0 = newest
+const char* faultName(uint8_t cause);
+void faultDump(Print& out);   // serial command 'f'
+
+#endif
@@ -0,0 +1,105 @@
+#include "resume.h"
+#include "config.h"
+#include "soc.h"
+#include "crc32.h"
+#include "statuslog.h"
+#include <esp_sleep.h>
+
+#define RESUME_MAGIC 0x52534D31 // "RSM1"
+
+struct ResumeBlock {
+    uint32_t magic;
+    uint16_t size;
+    bool usbOut;
+    bool acOut;
+    int32_t dcMode;
+    float dcVbus;
+    float dcIbus;
+    SocState soc;
+    uint8_t logCount;
+    LogRecord log[RESUME_LOG_LINES];
+    uint32_t crc;     // over everything above
+};
+
+RTC_DATA_ATTR ResumeBlock resumeBlock;
+
+bool warmBoot = false;
+
+struct BootPhase {
+    const char* name;
+    uint32_t atUs;
+};
+
+BootPhase bootPhases[BOOT_PHASES];
+int bootPhaseCount = 0;
+
+static uint32_t blockCrc() {
+    return crc32(&resumeBlock, offsetof(ResumeBlock, crc));
+}
+
+bool resumeCheck() {
+    bootMark("reset");
+    warmBoot = esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_GPIO &&
+               resumeBlock.magic == RESUME_MAGIC &&
+               resumeBlock.size == sizeof(ResumeBlock) &&
+               resumeBlock.crc == blockCrc();
+    resumeBlock.magic = 0; // one shot: a later cold reset must not reuse it
+    return warmBoot;
+}
+
+bool resumeIsWarm() {
+    return warmBoot;
+}
+
+void resumeRestore() {
+    if (!warmBoot) return;
+    qm_usb_out = resumeBlock.usbOut;
+    qm_ac_out = resumeBlock.acOut;
+    qm_dc_mode_index = resumeBlock.dcMode;
+    qm_dc_vbus = resumeBlock.dcVbus;
+    qm_dc_ibus = resumeBlock.dcIbus;
+    socRestore(resumeBlock.soc);
+    for (int i = 0; i < resumeBlock.logCount && i < RESUME_LOG_LINES; i++) {
+        logRestore(resumeBlock.log[i]);
+    }
+}
+
+void resumeSave() {
+    memset(&resumeBlock, 0, sizeof(resumeBlock));
+    resumeBlock.magic = RESUME_MAGIC;
+    resumeBlock.size = sizeof(ResumeBlock);
+    resumeBlock.usbOut = qm_usb_out;
+    resumeBlock.acOut = qm_ac_out;
+    resumeBlock.dcMode = qm_dc_mode_index;
+    resumeBlock.dcVbus = qm_dc_vbus;
+    resumeBlock.dcIbus = qm_dc_ibus;
+    socExport(resumeBlock.soc);
+
+    // oldest first, so restoring keeps the order. Text pointers stay valid:
+    // a GPIO wake from deep sleep runs the same image.
+    uint32_t end = logEndSeq();
+    uint32_t first = max(logFirstSeq(), end > RESUME_LOG_LINES ? end - RESUME_LOG_LINES : 0);
+    for (uint32_t seq = first; seq < end; seq++) {
+        const LogRecord* r = logGet(seq);
+        if (r) resumeBlock.log[resumeBlock.logCount++] = *r;
+    }
+    resumeBlock.crc = blockCrc();
+}
+
+void bootMark(const char* phase) {
+    if (bootPhaseCount >= BOOT_PHASES) return;
+    bootPhases[bootPhaseCount].name = phase;
+    bootPhases[bootPhaseCount].atUs = micros();
+    bootPhaseCount++;
+}
+
+void bootReport() {
+    Serial.printf("Boot (%s):", warmBoot ? "warm" : "cold");
+    for (int i = 1; i < bootPhaseCount; i++) {
+        Serial.printf(" %s %lums", bootPhases[i].name, (unsigned long)(bootPhases[i].atUs - bootPhases[i - 1].atUs) / 1000);
+    }
+    uint32_t totalMs = bootPhases[bootPhaseCount - 1].atUs / 1000;
+    Serial.printf(", usable at %lums\n", (unsigned long)totalMs);
+
+    logEvent(LOG_INFO, EV_BOOT_TIME, warmBoot, totalMs);
+}
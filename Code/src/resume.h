@@ -0,0 +1,21 @@
+#ifndef RESUME_H
+#define RESUME_H
+
+#include <Arduino.h>
+
+// Warm resume from deep sleep. executeShutdown() leaves a CRC-checked block in
+// RTC memory; an ENTER wake that finds it intact restores outputs, DC mode,
+// SOC and the log tail and skips the one-time hardware set-up.
+
+#define RESUME_LOG_LINES 6
+#define BOOT_PHASES 8
+
+bool resumeCheck();           // call first thing in setup()
+bool resumeIsWarm();
+void resumeRestore();         // after settings are loaded
+void resumeSave();            // just before deep sleep
+
+void bootMark(const char* phase);
+void bootReport();
+
+#endif
@@ -0,0 +1,112 @@
+#include "sampler.h"
+#include "system.h"
+#include "i2cbus.h"
+#include "protect.h"
+#include "telemstream.h"
+#include <Wire.h>
+
+// Ring indices are free-running; head is only written by the bus task,
+// tail only by the loop, so no lock is needed.
+BatterySample sampleRing[SAMPLE_RING_SIZE];
+volatile uint32_t sampleHead = 0;
+volatile uint32_t sampleTail = 0;
+uint32_t samplerOverruns = 0;
+
+volatile bool sampleJobBusy = false;
+
+// The INA219 library only hands out floats, so its result registers are read directly
+bool ina219ReadRegister(uint8_t reg, uint16_t& val) {
+    Wire.beginTransmission(INA219_ADDR);
+    Wire.write(reg);
+    if (Wire.endTransmission() != 0) return false;
+    if (Wire.requestFrom((uint8_t)INA219_ADDR, (uint8_t)2) != 2) return false;
+    val = (uint16_t)Wire.read() << 8;
+    val |= Wire.read();
+    return true;
+}
+
+bool sampleJob(void* ctx) {
+    uint16_t busRaw, shuntRaw;
+    if (!ina219ReadRegister(0x01, shuntRaw) || !ina219ReadRegister(0x02, busRaw)) return false;
+
+    // bus: bits [15:3] at 4 mV/LSB, shunt: signed 10 uV/LSB across INA219_SHUNT_MOHM
+    int32_t vbatMv = (busRaw >> 3) * 4;
+    int32_t ibatMa = (int32_t)(int16_t)shuntRaw * 10 / INA219_SHUNT_MOHM;
+    // clipped at full scale, or OVF (bus register bit 0) set: the current is off the range
+    int16_t shunt = (int16_t)shuntRaw;
+    bool saturated = (busRaw & 0x01) || shunt >= PROT_SHUNT_FULL_SCALE || shunt <= -PROT_SHUNT_FULL_SCALE;
+    int32_t pvMv = vbatMv, piMa = ibatMa;
+    if (protectSimulating(piMa, pvMv)) saturated = abs(piMa) >= PROT_FULL_SCALE_MA;
+    uint32_t atUs = micros();
+    protectBatterySample(piMa, pvMv, saturated, atUs);
+
+    int16_t ibat16 = (int16_t)constrain(ibatMa, (int32_t)INT16_MIN, (int32_t)INT16_MAX);
+    streamSample((uint16_t)vbatMv, ibat16, atUs);
+
+    if (sampleHead - sampleTail >= SAMPLE_RING_SIZE) {
+        samplerOverruns++;
+        return true;
+    }
+
+    BatterySample& s = sampleRing[sampleHead & (SAMPLE_RING_SIZE - 1)];
+    s.atUs = atUs;
+    s.vbat_mv = (uint16_t)vbatMv;
+    s.ibat_ma = ibat16;
+    __sync_synchronize(); // publish the sample before the index
+    sampleHead = sampleHead + 1;
+    return true;
+}
+
+void sampleJobDone(void* ctx, bool ok) {
+    sampleJobBusy = false;
+}
+
+void samplerTask(void* arg) {
+    TickType_t lastWake = xTaskGetTickCount();
+    for (;;) {
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(INA_SAMPLE_PERIOD_MS));
+        if (sampleJobBusy) continue; // bus is backed up, skip rather than pile up
+        sampleJobBusy = true;
+        if (!i2cSubmit(I2C_PRIO_SENSOR, sampleJob, sampleJobDone)) sampleJobBusy = false;
+    }
+}
+
+void samplerStart() {
+    xTaskCreate(samplerTask, "inasampler", 2048, nullptr, 3, nullptr);
+}
+
+bool samplerReadWindow(SampleWindow& w) {
+    uint32_t head = sampleHead;
+    __sync_synchronize();
+    uint32_t n = head - sampleTail;
+    if (n == 0) return false;
+
+    static uint32_t prevLastUs = 0;
+    static bool havePrev = false;
+
+    int32_t vSum = 0, iSum = 0;
+    int32_t iMin = INT32_MAX, iMax = INT32_MIN;
+    uint64_t iSq = 0;
+    for (uint32_t t = sampleTail; t != head; t++) {
+        const BatterySample& s = sampleRing[t & (SAMPLE_RING_SIZE - 1)];
+        vSum += s.vbat_mv;
+        iSum += s.ibat_ma;
+        if (s.ibat_ma < iMin) iMin = s.ibat_ma;
+        if (s.ibat_ma > iMax) iMax = s.ibat_ma;
+        iSq += (int64_t)s.ibat_ma * s.ibat_ma;
+    }
+    uint32_t lastUs = sampleRing[(head - 1) & (SAMPLE_RING_SIZE - 1)].atUs;
+    sampleTail = head;
+
+    w.count = (uint16_t)n;
+    w.vbatMeanMv = vSum / (int32_t)n;
+    w.ibatMeanMa = iSum / (int32_t)n;
+    w.ibatMinMa = iMin;
+    w.ibatMaxMa = iMax;
+    w.ibatRmsMa = (int32_t)isqrt64(iSq / n);
+    w.ibatSumMa = iSum;
+    w.spanUs = havePrev ? lastUs - prevLastUs : n * INA_SAMPLE_PERIOD_MS * 1000;
+    prevLastUs = lastUs;
+    havePrev = true;
+    return true;
+}
@@ -0,0 +1,37 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <Arduino.h>
+
+// Continuous INA219 acquisition. A timer task queues one bus/shunt read per
+// conversion period; the bus task pushes each sample into a single-producer
+// ring that the 100 ms tick drains into window statistics.
+
+#define INA_AVG_SAMPLES_LOG2 2   // 4-sample hardware averaging, 2.13 ms per channel
+#define INA_SAMPLE_PERIOD_MS 5   // just above one shunt + bus conversion cycle
+#define SAMPLE_RING_SIZE 128     // power of two, ~640 ms of samples
+
+struct BatterySample {
+    uint32_t atUs;
+    uint16_t vbat_mv;
+    int16_t ibat_ma;
+};
+
+struct SampleWindow {
+    uint16_t count;
+    int32_t vbatMeanMv;
+    int32_t ibatMeanMa;
+    int32_t ibatMinMa;
+    int32_t ibatMaxMa;
+    int32_t ibatRmsMa;
+    int32_t ibatSumMa;    // sum of samples
+    uint32_t spanUs;      // previous window's last sample to this one's, skipped reads included
+};
+
+extern uint32_t samplerOverruns;
+
+bool ina219ReadRegister(uint8_t reg, uint16_t& val);
+void samplerStart();
+bool samplerReadWindow(SampleWindow& w);
+
+#endif
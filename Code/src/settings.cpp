@@ -0,0 +1,248 @@
+#include "settings.h"
+#include "config.h"
+#include "fixedpoint.h"
+#include "crc32.h"
+#include "statuslog.h"
+#include <Preferences.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+Preferences settingsPrefs;
+SettingsStats settingsStats;
+SemaphoreHandle_t settingsMutex = nullptr; // flushes come from the UI, control and network tasks
+volatile bool settingsDirty = false;
+volatile uint32_t lastEditMs = 0;
+
+// Append new fields at the end and bump SETTINGS_VERSION. v2: streamRate.
+struct __attribute__((packed)) SettingsPayload {
+    int16_t dcVbus;
+    int16_t dcIbus;
+    uint8_t apoEnable;
+    int16_t apoCurrThres;
+    int16_t apoAcThres;
+    int16_t apoDelay;
+    uint8_t chargeVolt;
+    int16_t ibatLimit;
+    int16_t mpptStart;
+    int16_t mpptMin;
+    int16_t mpptMax;
+    int16_t mpptStep;
+    int16_t mpptInterval;
+    uint8_t mpptAlgo;
+    int16_t mpptSweep;
+    uint8_t fanTest;
+    int16_t fanMinPwm;
+    int16_t tbatMin;
+    int16_t tbatMax;
+    int16_t tmodMin;
+    int16_t tmodMax;
+    int16_t tinvMin;
+    int16_t tinvMax;
+    int16_t calMinVcel;
+    int16_t calMaxVcel;
+    int16_t calSag;
+    uint8_t wifiMode;
+    uint8_t beeper;
+    uint8_t streamRate;
+};
+
+struct __attribute__((packed)) SettingsBlob {
+    uint16_t version;
+    uint16_t size;      // payload bytes
+    uint32_t crc;       // over the payload
+    SettingsPayload payload;
+};
+
+// Bools and option indexes are stored as uint8, ints as int16, floats as
+// int16 hundredths. The key is the pre-blob NVS key, used for migration.
+struct SettingField {
+    const char* legacyKey;
+    ItemType type;
+    void* variable;
+    uint8_t offset;
+};
+
+#define FIELD(key, type, var, member) {key, type, &var, offsetof(SettingsPayload, member)}
+
+static const SettingField settingFields[] = {
+    FIELD("dcv", ITEM_FLOAT, qm_dc_vbus, dcVbus),
+    FIELD("dci", ITEM_FLOAT, qm_dc_ibus, dcIbus),
+    FIELD("apo_en", ITEM_BOOL, apo_enable, apoEnable),
+    FIELD("apo_th", ITEM_INT, apo_curr_thres, apoCurrThres),
+    FIELD("apo_ac", ITEM_INT, apo_ac_thres, apoAcThres),
+    FIELD("apo_del", ITEM_INT, apo_delay, apoDelay),
+    FIELD("sc_v", ITEM_STRING, sc_charge_volt_index, chargeVolt),
+    FIELD("sc_i", ITEM_FLOAT, sc_ibat_limit, ibatLimit),
+    FIELD("m_start", ITEM_FLOAT, mppt_start_volt, mpptStart),
+    FIELD("m_min", ITEM_FLOAT, mppt_min_volt, mpptMin),
+    FIELD("m_max", ITEM_FLOAT, mppt_max_volt, mpptMax),
+    FIELD("m_step", ITEM_FLOAT, mppt_step, mpptStep),
+    FIELD("m_int", ITEM_FLOAT, mppt_interval, mpptInterval),
+    FIELD("m_alg", ITEM_STRING, mppt_algo_index, mpptAlgo),
+    FIELD("m_swp", ITEM_INT, mppt_sweep_min, mpptSweep),
+    FIELD("f_test", ITEM_BOOL, fan_test_startup, fanTest),
+    FIELD("f_min", ITEM_INT, fan_min_pwm, fanMinPwm),
+    FIELD("tb_min", ITEM_FLOAT, tbat_min, tbatMin),
+    FIELD("tb_max", ITEM_FLOAT, tbat_max, tbatMax),
+    FIELD("tm_min", ITEM_FLOAT, tmod_min, tmodMin),
+    FIELD("tm_max", ITEM_FLOAT, tmod_max, tmodMax),
+    FIELD("ti_min", ITEM_FLOAT, tinv_min, tinvMin),
+    FIELD("ti_max", ITEM_FLOAT, tinv_max, tinvMax),
+    FIELD("c_min", ITEM_FLOAT, cal_min_soc_vcel, calMinVcel),
+    FIELD("c_max", ITEM_FLOAT, cal_max_soc_vcel, calMaxVcel),
+    FIELD("c_sag", ITEM_FLOAT, cal_sag_comp, calSag),
+    FIELD("wifi", ITEM_STRING, wifi_mode_index, wifiMode),
+    FIELD("beep", ITEM_BOOL, sys_beeper, beeper),
+    FIELD("ts_rate", ITEM_STRING, stream_rate_index, streamRate)
+};
+
+const int SETTING_FIELDS = sizeof(settingFields) / sizeof(settingFields[0]);
+
+bool settingsPersists(const void* variable) {
+    for (int i = 0; i < SETTING_FIELDS; i++) {
+        if (settingFields[i].variable == variable) return true;
+    }
+    return false;
+}
+
+SettingsBlob storedBlob;   // what NVS holds, to skip writes that change nothing
+
+static void capture(SettingsPayload& p) {
+    uint8_t* base = (uint8_t*)&p;
+    for (int i = 0; i < SETTING_FIELDS; i++) {
+        const SettingField& f = settingFields[i];
+        int16_t v16;
+        switch (f.type) {
+            case ITEM_BOOL:   base[f.offset] = *(bool*)f.variable; break;
+            case ITEM_STRING: base[f.offset] = (uint8_t)*(int*)f.variable; break;
+            case ITEM_INT:    v16 = (int16_t)*(int*)f.variable; memcpy(base + f.offset, &v16, 2); break;
+            case ITEM_FLOAT:  v16 = (int16_t)toCenti(*(float*)f.variable); memcpy(base + f.offset, &v16, 2); break;
+            default: break;
+        }
+    }
+}
+
+static void apply(const SettingsPayload& p) {
+    const uint8_t* base = (const uint8_t*)&p;
+    for (int i = 0; i < SETTING_FIELDS; i++) {
+        const SettingField& f = settingFields[i];
+        int16_t v16;
+        switch (f.type) {
+            case ITEM_BOOL:   *(bool*)f.variable = base[f.offset] != 0; break;
+            case ITEM_STRING: *(int*)f.variable = base[f.offset]; break;
+            case ITEM_INT:    memcpy(&v16, base + f.offset, 2); *(int*)f.variable = v16; break;
+            case ITEM_FLOAT:  memcpy(&v16, base + f.offset, 2); *(float*)f.variable = fromCenti(v16); break;
+            default: break;
+        }
+    }
+}
+
+static void writeBlob() {
+    SettingsBlob blob;
+    memset(&blob, 0, sizeof(blob));
+    blob.version = SETTINGS_VERSION;
+    blob.size = sizeof(SettingsPayload);
+    capture(blob.payload);
+    blob.crc = crc32(&blob.payload, sizeof(blob.payload));
+
+    if (memcmp(&blob, &storedBlob, sizeof(blob)) == 0) {
+        settingsStats.skipped++;
+        return;
+    }
+    settingsPrefs.putBytes("blob", &blob, sizeof(blob));
+    storedBlob = blob;
+    settingsStats.writes++;
+    settingsStats.bytesWritten += sizeof(blob);
+}
+
+// One-off upgrade from the per-key layout; the old keys are removed after.
+static bool migrateLegacy() {
+    uint32_t start = micros();
+    bool found = false;
+    for (int i = 0; i < SETTING_FIELDS; i++) {
+        const SettingField& f = settingFields[i];
+        if (!settingsPrefs.isKey(f.legacyKey)) continue;
+        found = true;
+        switch (f.type) {
+            case ITEM_BOOL:   *(bool*)f.variable = settingsPrefs.getBool(f.legacyKey); break;
+            case ITEM_INT:
+            case ITEM_STRING: *(int*)f.variable = settingsPrefs.getInt(f.legacyKey); break;
+            case ITEM_FLOAT:  *(float*)f.variable = settingsPrefs.getFloat(f.legacyKey); break;
+            default: break;
+        }
+    }
+    settingsStats.legacyUs = micros() - start;
+    if (!found) return false;
+    for (int i = 0; i < SETTING_FIELDS; i++) settingsPrefs.remove(settingFields[i].legacyKey);
+    return true;
+}
+
+void settingsLoad() {
+    uint32_t start = micros();
+    settingsMutex = xSemaphoreCreateMutex();
+    settingsPrefs.begin("settings", false);
+
+    // large enough for a blob written by newer firmware
+    uint8_t raw[sizeof(SettingsBlob) + 128];
+    size_t len = settingsPrefs.getBytes("blob", raw, sizeof(raw));
+    const SettingsBlob* blob = (const SettingsBlob*)raw;
+    size_t header = offsetof(SettingsBlob, payload);
+
+    if (len == 0) {
+        settingsStats.source = migrateLegacy() ? SETTINGS_LEGACY : SETTINGS_DEFAULTS;
+        writeBlob();
+    } else if (len >= header && blob->size == len - header && blob->crc == crc32(raw + header, blob->size)) {
+        SettingsPayload p;
+        capture(p); // defaults for anything the stored version does not have
+        memcpy(&p, raw + header, min((size_t)blob->size, sizeof(p)));
+        apply(p);
+        if (blob->version < SETTINGS_VERSION) {
+            settingsStats.source = SETTINGS_UPGRADED;
+            writeBlob();
+        } else {
+            settingsStats.source = SETTINGS_BLOB;
+            if (len == sizeof(SettingsBlob)) memcpy(&storedBlob, raw, sizeof(storedBlob));
+        }
+    } else {
+        settingsStats.source = SETTINGS_DEFAULTS;
+        logEvent(LOG_WARN, EV_SETTINGS_CORRUPT);
+        writeBlob();
+    }
+    settingsStats.loadUs = micros() - start;
+
+    static const char* sources[] = {"defaults", "blob", "upgraded", "legacy keys"};
+    Serial.printf("Settings v%d from %s: %lu bytes in %luus", SETTINGS_VERSION, sources[settingsStats.source],
+                  (unsigned long)sizeof(SettingsBlob), (unsigned long)settingsStats.loadUs);
+    if (settingsStats.source == SETTINGS_LEGACY) {
+        Serial.printf(" (%d legacy reads took %luus)", SETTING_FIELDS, (unsigned long)settingsStats.legacyUs);
+    }
+    Serial.println();
+}
+
+void settingsMarkDirty() {
+    if (settingsDirty) settingsStats.coalesced++;
+    lastEditMs = millis();
+    settingsDirty = true;
+}
+
+void settingsService() {
+    if (settingsDirty && millis() - lastEditMs >= SETTINGS_IDLE_FLUSH_MS) settingsFlush();
+}
+
+void settingsFlush() {
+    xSemaphoreTake(settingsMutex, portMAX_DELAY);
+    if (settingsDirty) {
+        settingsDirty = false;
+        writeBlob();
+    }
+    xSemaphoreGive(settingsMutex);
+}
+
+// pending edits are dropped, the caller is about to restart on defaults
+void settingsClear() {
+    xSemaphoreTake(settingsMutex, portMAX_DELAY);
+    settingsDirty = false;
+    settingsPrefs.clear();
+    memset(&storedBlob, 0, sizeof(storedBlob));
+    xSemaphoreGive(settingsMutex);
+}
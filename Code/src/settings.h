@@ -0,0 +1,46 @@
+#ifndef SETTINGS_H
+#define SETTINGS_H
+
+#include <Arduino.h>
+
+// Every persistent setting lives in one packed blob in NVS ("settings"/"blob"),
+// read once at boot and written whole, so an edit can never leave a half
+// updated set behind. The header carries a version and a CRC of the payload.
+// Fields are only ever appended: an older blob is laid over the defaults, so
+// fields added since keep their defaults. Floats are stored in hundredths.
+// Edits only mark the settings dirty; they are written in one go once the
+// menu has been left alone for SETTINGS_IDLE_FLUSH_MS, and on shutdown or
+// before a restart.
+
+#define SETTINGS_VERSION 2
+#define SETTINGS_IDLE_FLUSH_MS 5000
+
+enum SettingsSource {
+    SETTINGS_DEFAULTS,   // nothing stored, or the blob failed its CRC
+    SETTINGS_BLOB,
+    SETTINGS_UPGRADED,   // older blob version, rewritten
+    SETTINGS_LEGACY      // migrated from the old one-key-per-setting layout
+};
+
+struct SettingsStats {
+    uint8_t source;
+    uint32_t loadUs;        // boot: NVS open to globals applied
+    uint32_t legacyUs;      // time the old per-key reads took, when migrating
+    uint32_t writes;        // blob commits
+    uint32_t skipped;       // flushes that matched what was already stored
+    uint32_t coalesced;     // edits folded into an already pending flush
+    uint32_t bytesWritten;
+};
+
+extern SettingsStats settingsStats;
+
+void settingsLoad();
+// true for a variable in the stored blob; the field table in settings.cpp is
+// the only list of what persists
+bool settingsPersists(const void* variable);
+void settingsMarkDirty();
+void settingsService();
+void settingsFlush();
+void settingsClear();
+
+#endif
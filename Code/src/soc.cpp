@@ -0,0 +1,126 @@
+#include "soc.h"
+#include <Preferences.h>
+
+#define SOC_MAGIC 0x534F4331 // "SOC1"
+#define MAMS_PER_MAH 3600000LL
+
+Preferences socPrefs;
+SocState soc;
+bool socSeeded = false;
+bool socWarm = false;          // restored from the resume block, skip NVS
+
+int64_t anchorNetMaMs = 0;     // charge moved since the last anchor
+int32_t anchorSoc = -1;        // SOC at the last anchor, -1 = none yet
+unsigned long restSince = 0;
+bool restAnchored = false;
+bool wasCharging = false;
+int32_t ibatAvgQ8 = 0;         // slow IBAT average for time-to-empty, Q24.8
+
+static int64_t capacityMaMs() {
+    return (int64_t)soc.capacityMah * MAMS_PER_MAH;
+}
+
+static int32_t socPermille() {
+    int64_t cap = capacityMaMs();
+    if (cap <= 0) return 0;
+    return (int32_t)constrain(soc.remainingMaMs * 1000 / cap, 0LL, 1000LL);
+}
+
+static void learnCapacity(int32_t newSoc) {
+    if (anchorSoc < 0) return;
+    int32_t swing = abs(newSoc - anchorSoc);
+    if (swing < SOC_LEARN_MIN_PERMILLE) return;
+
+    int64_t moved = anchorNetMaMs < 0 ? -anchorNetMaMs : anchorNetMaMs;
+    int32_t est = (int32_t)(moved * 1000 / swing / MAMS_PER_MAH);
+    est = constrain(est, SOC_DESIGN_CAPACITY_MAH / 2, SOC_DESIGN_CAPACITY_MAH * 6 / 5);
+    soc.capacityMah = (soc.capacityMah * 3 + est) / 4;
+}
+
+static void anchor(int32_t newSoc) {
+    learnCapacity(newSoc);
+    soc.remainingMaMs = capacityMaMs() * newSoc / 1000;
+    anchorSoc = newSoc;
+    anchorNetMaMs = 0;
+    socSave();
+}
+
+void socSetup() {
+    socPrefs.begin("soc", false);
+    if (socWarm) {
+        socSeeded = true;
+    } else if (socPrefs.getBytes("state", &soc, sizeof(soc)) == sizeof(soc) && soc.magic == SOC_MAGIC) {
+        socSeeded = true;
+    } else {
+        soc.magic = SOC_MAGIC;
+        soc.capacityMah = SOC_DESIGN_CAPACITY_MAH;
+        soc.remainingMaMs = 0;
+    }
+    // the pack may have been charged while we were off, so the first quiet tick
+    // re-anchors. Not after a resume: the counter was current when we slept, so
+    // keep it until a full rest period.
+    restSince = 0;
+    restAnchored = false;
+    if (socWarm) anchorSoc = socPermille();
+}
+
+int32_t socUpdate(int32_t chargeMaMs, int32_t ibatMa, int32_t vbatMv, int32_t fullMv, int32_t voltageSoc) {
+    unsigned long now = millis();
+    if (vbatMv <= 0) return socPermille(); // no reading yet, never anchor on it
+
+    if (!socSeeded) {
+        soc.remainingMaMs = capacityMaMs() * voltageSoc / 1000;
+        socSeeded = true;
+    }
+
+    soc.remainingMaMs = constrain(soc.remainingMaMs + chargeMaMs, 0LL, capacityMaMs());
+    anchorNetMaMs += chargeMaMs;
+    ibatAvgQ8 += (ibatMa * 256 - ibatAvgQ8) / 256;
+
+    // rest anchor: once per rest period, straight away on the first rest after boot
+    if (abs(ibatMa) < SOC_REST_MA) {
+        if (restSince == 0) restSince = now;
+        bool booting = (anchorSoc < 0);
+        if (!restAnchored && (booting || now - restSince >= SOC_REST_MS)) {
+            anchor(voltageSoc);
+            restAnchored = true;
+        }
+    } else {
+        restSince = 0;
+        restAnchored = false;
+    }
+
+    // full anchor: charge current has tapered off at the top of the curve
+    if (ibatMa > SOC_TAPER_MA) wasCharging = true;
+    else if (wasCharging && ibatMa >= 0 && vbatMv >= fullMv) {
+        anchor(1000);
+        wasCharging = false;
+    }
+    if (ibatMa < -SOC_REST_MA) wasCharging = false;
+
+    return socPermille();
+}
+
+void socSave() {
+    socPrefs.putBytes("state", &soc, sizeof(soc));
+}
+
+void socExport(SocState& s) {
+    s = soc;
+}
+
+void socRestore(const SocState& s) {
+    if (s.magic != SOC_MAGIC) return;
+    soc = s;
+    socWarm = true;
+}
+
+int32_t socTimeToEmptyMin() {
+    int32_t avg = ibatAvgQ8 / 256;
+    if (avg > -SOC_REST_MA) return -1;
+    return (int32_t)(soc.remainingMaMs / (60000LL * -avg));
+}
+
+int32_t socCapacityMah() {
+    return soc.capacityMah;
+}
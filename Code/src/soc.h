@@ -0,0 +1,31 @@
+#ifndef SOC_H
+#define SOC_H
+
+#include <Arduino.h>
+
+// Coulomb-counting state of charge. Charge is integrated from every INA219
+// sample (positive IBAT = charging) and re-anchored to the voltage curve when
+// the pack has rested, or to 100% when the charge current tapers off at full
+// voltage. Usable capacity is re-learnt from the charge moved between anchors.
+
+#define SOC_DESIGN_CAPACITY_MAH 28000   // 4S8P x 3500 mAh
+#define SOC_REST_MA 50                  // |IBAT| below this counts as resting
+#define SOC_REST_MS (10UL * 60 * 1000)  // rest time before trusting the voltage
+#define SOC_TAPER_MA 300                // charge current that means "full" at max voltage
+#define SOC_LEARN_MIN_PERMILLE 400      // minimum SOC swing to update the capacity
+
+struct SocState {
+    uint32_t magic;
+    int32_t capacityMah;
+    int64_t remainingMaMs;
+};
+
+void socSetup();
+int32_t socUpdate(int32_t chargeMaMs, int32_t ibatMa, int32_t vbatMv, int32_t fullMv, int32_t voltageSoc);
+void socSave();
+int32_t socTimeToEmptyMin();   // -1 when not discharging
+int32_t socCapacityMah();
+void socExport(SocState& s);
+void socRestore(const SocState& s);   // before socSetup(), from the resume block
+
+#endif
@@ -0,0 +1,111 @@
+#include "statuslog.h"
+#include "protect.h"
+#include "format.h"
+#include "journal.h"
+#include <freertos/FreeRTOS.h>
+
+LogRecord logRing[LOG_CAPACITY];
+volatile uint32_t logEnd = 0;
+portMUX_TYPE logMux = portMUX_INITIALIZER_UNLOCKED;
+
+static void append(LogRecord r) {
+    portENTER_CRITICAL(&logMux);
+    r.seq = logEnd;
+    logRing[r.seq & (LOG_CAPACITY - 1)] = r;
+    logEnd = r.seq + 1;
+    portEXIT_CRITICAL(&logMux);
+}
+
+void logEvent(LogSeverity sev, LogCode code, int32_t a0, int32_t a1, int32_t a2, const char* text) {
+    LogRecord r;
+    r.atMs = millis();
+    r.severity = sev;
+    r.code = code;
+    r.flags = 0;
+    r.text = text;
+    r.args[0] = a0;
+    r.args[1] = a1;
+    r.args[2] = a2;
+    append(r);
+    journalAppend(r);
+}
+
+void logStatus(const char* msg) {
+    logEvent(LOG_INFO, EV_TEXT, 0, 0, 0, msg);
+}
+
+void logRestore(const LogRecord& r) {
+    LogRecord copy = r;
+    copy.flags |= LOG_PREV_BOOT;
+    append(copy);
+}
+
+uint32_t logFirstSeq() {
+    uint32_t end = logEnd;
+    return end > LOG_CAPACITY ? end - LOG_CAPACITY : 0;
+}
+
+uint32_t logEndSeq() {
+    return logEnd;
+}
+
+const LogRecord* logGet(uint32_t seq) {
+    const LogRecord* r = &logRing[seq & (LOG_CAPACITY - 1)];
+    return logValid(r, seq) ? r : nullptr;
+}
+
+bool logValid(const LogRecord* r, uint32_t seq) {
+    return seq < logEnd && r->seq == seq;
+}
+
+static const FmtSpec MPPT_VOLTS = {1000, 1, 0, "V"};
+static const FmtSpec MPPT_WATTS = {1000, 1, 0, "W"};
+
+int logFormatMessage(const LogRecord& r, char* out, size_t len) {
+    const int32_t* a = r.args;
+    char v[FMT_MAX_LEN], w[FMT_MAX_LEN];
+    switch (r.code) {
+        case EV_TEXT:
+            return snprintf(out, len, "%s", r.text ? r.text : "");
+        case EV_BOOTED:
+            return snprintf(out, len, "System %s", a[0] ? "Resumed" : "Booted");
+        case EV_BOOT_TIME:
+            return snprintf(out, len, "Boot %s %ldms", a[0] ? "warm" : "cold", (long)a[1]);
+        case EV_OUTPUT:
+            return snprintf(out, len, "%s: %s", r.text ? r.text : "?", a[0] ? "ON" : "OFF");
+        case EV_DC_SET:
+            return snprintf(out, len, "DC Params Set");
+        case EV_FAULT:
+            if (a[0] == FAULT_OVERTEMP) {
+                fmtFixed(v, sizeof(v), a[1], FMT_CELSIUS);
+                return snprintf(out, len, "FAULT %s T%ld %s", faultName(a[0]), (long)a[2], v);
+            }
+            return snprintf(out, len, "FAULT %s %ld %ldus", faultName(a[0]), (long)a[1], (long)a[2]);
+        case EV_FAULT_CLEARED:
+            return snprintf(out, len, "Fault Cleared");
+        case EV_SETTINGS_CLEARED:
+            return snprintf(out, len, "Settings Cleared");
+        case EV_SETTINGS_CORRUPT:
+            return snprintf(out, len, "Settings Corrupt");
+        case EV_MPPT_SWEEP:
+            fmtFixed(v, sizeof(v), a[0], MPPT_VOLTS);
+            fmtFixed(w, sizeof(w), a[1], MPPT_WATTS);
+            return snprintf(out, len, "MPPT %s %s", v, w);
+        case EV_WIFI_UP:
+            return snprintf(out, len, "Wi-Fi Up %lddBm", (long)a[0]);
+        case EV_WIFI_DOWN:
+            return snprintf(out, len, "Wi-Fi Lost r%ld after %lds", (long)a[0], (long)a[1]);
+        case EV_WIFI_FALLBACK:
+            return snprintf(out, len, "Wi-Fi AP Fallback (%ld)", (long)a[0]);
+        default:
+            return snprintf(out, len, "event %d", r.code);
+    }
+}
+
+int logFormat(const LogRecord& r, char* out, size_t len) {
+    int n;
+    if (r.flags & LOG_PREV_BOOT) n = snprintf(out, len, "--:-- ");
+    else n = snprintf(out, len, "%lu:%02lu ", (unsigned long)(r.atMs / 60000), (unsigned long)(r.atMs / 1000 % 60));
+    if (n < 0 || (size_t)n >= len) return n;
+    return n + logFormatMessage(r, out + n, len - n);
+}
@@ -0,0 +1,60 @@
+#ifndef STATUSLOG_H
+#define STATUSLOG_H
+
+#include <Arduino.h>
+
+// Status log: a fixed ring of small records, appended in O(1) from any task.
+// A record holds an event code and its arguments; text is only produced when
+// a line is rendered. Readers walk the ring in place by sequence number and
+// re-check the record's seq after use, since a writer may have lapped them.
+// logEvent() also stages each record for the flash journal.
+
+#define LOG_CAPACITY 32   // power of two
+#define LOG_LINE_LEN 40
+
+enum LogSeverity {
+    LOG_INFO,
+    LOG_WARN,
+    LOG_FAULT
+};
+
+enum LogCode {
+    EV_TEXT,             // text
+    EV_BOOTED,           // a0: warm
+    EV_BOOT_TIME,        // a0: warm, a1: ms
+    EV_OUTPUT,           // text: item name, a0: on
+    EV_DC_SET,
+    EV_FAULT,            // a0: cause, a1: value, a2: latency us or sensor
+    EV_FAULT_CLEARED,
+    EV_SETTINGS_CLEARED,
+    EV_SETTINGS_CORRUPT,
+    EV_MPPT_SWEEP,       // a0: Vmp mV, a1: Pmax mW
+    EV_WIFI_UP,          // a0: RSSI dBm
+    EV_WIFI_DOWN,        // a0: driver reason, a1: link up s
+    EV_WIFI_FALLBACK     // a0: failed attempts
+};
+
+#define LOG_PREV_BOOT 0x01  // carried over a deep sleep, atMs is from the previous boot
+
+struct LogRecord {
+    uint32_t seq;
+    uint32_t atMs;
+    uint8_t severity;
+    uint8_t code;
+    uint8_t flags;
+    const char* text;    // must be a literal or otherwise live forever
+    int32_t args[3];
+};
+
+void logEvent(LogSeverity sev, LogCode code, int32_t a0 = 0, int32_t a1 = 0, int32_t a2 = 0, const char* text = nullptr);
+void logStatus(const char* msg);   // EV_TEXT at LOG_INFO, msg must be a literal
+void logRestore(const LogRecord& r);
+
+uint32_t logFirstSeq();            // oldest record still held
+uint32_t logEndSeq();              // one past the newest
+const LogRecord* logGet(uint32_t seq);  // nullptr once overwritten
+bool logValid(const LogRecord* r, uint32_t seq);
+int logFormat(const LogRecord& r, char* out, size_t len);         // "m:ss message"
+int logFormatMessage(const LogRecord& r, char* out, size_t len);  // message only
+
+#endif
@@ -1,5 +1,19 @@
 #include "system.h"
 #include "display.h"
+#include "i2cbus.h"
+#include "sampler.h"
+#include "history.h"
+#include "soc.h"
+#include "mppt.h"
+#include "telemetry.h"
+#include "protect.h"
+#include "fanctl.h"
+#include "power.h"
+#include "resume.h"
+#include "settings.h"
+#include "statuslog.h"
+#include "journal.h"
+#include "wifimgr.h"
 
 INA219 INA(INA219_ADDR);
 OneWire oneWire(DS18B20_PIN);
@@ -13,12 +27,19 @@ DeviceAddress tempSensors[4] = {
   { 0x28, 0x2C, 0x97, 0x02, 0x00, 0x02, 0x24, 0xE7 }
 };
 
-float vbat = 0, ibat = 0, soc = 0;
-float vbat_read = 0, ibat_read = 0, pbat_read = 0;
-float vbus_read = 0, ibus_read = 0, pbus_read = 0;
-float vcel_read = 0;
-float tempReadings[4] = {0};
-float fanSpeed = 0;
+// Per-sensor resolution (9..12 bits): 9=94ms/0.5C, 10=188ms/0.25C, 11=375ms/0.125C, 12=750ms/0.0625C
+uint8_t tempResolution[4] = { 11, 10, 10, 10 };
+const unsigned long TEMP_STALE_MS = 5000;
+
+int32_t soc_permille = 0;
+int32_t vbat_mv = 0, ibat_ma = 0, pbat_mw = 0;
+int32_t vbus_mv = 0, ibus_ma = 0, pbus_mw = 0;
+int32_t vcel_mv = 0;
+int16_t tempCenti[4] = {0};
+unsigned long tempUpdatedAt[4] = {0};
+int fanPercent = 0;
+SampleWindow batWindow = {};
+bool batteryValid = false;   // an INA219 window with a real VBAT has arrived
 bool mpptActive = false;
 bool apoCountingDown = false;
 
@@ -27,9 +48,21 @@ byte pinStates[3] = {1, 1, 1};
 unsigned long enterPressTime = 0;
 bool enterLongHandled = false;
 
-int currentWifiState = -1;
 int pageScrollY = 0;
 
+struct SensorSample {
+    bool scValid;
+    uint32_t seq;
+    SC8812A::Telemetry sc;
+};
+
+SensorSample sensorSample;
+volatile bool sensorJobBusy = false;
+uint32_t busReadSeq = 0;              // SC8812A reads issued, bus task only
+uint32_t busSampleSeq = 0;            // read the current vbus/ibus came from
+volatile uint32_t mpptSettledSeq = 0; // first read issued after the last setpoint change
+int32_t mpptTargetMv = 0;
+
 void systemSetup() {
     pinMode(UP_PIN, INPUT_PULLUP);
     pinMode(DOWN_PIN, INPUT_PULLUP);
@@ -41,11 +74,17 @@ void systemSetup() {
     
     digitalWrite(PSTOP_PIN, HIGH);
     digitalWrite(EN_5V, HIGH);
+
+    i2cBusSetup(SDA_PIN, SCL_PIN);
     
     ledcSetup(0, 10000, 8);
     ledcAttachPin(FAN_PIN, 0);
-    
-    setupWiFi(wifi_mode_index);
+
+    powerSetup();
+    wifiRequest(wifi_mode_index);
+
+    // outputs and DC mode were on before the sleep, bring them back
+    if (resumeIsWarm()) applyPowerSettings();
 }
 
 void readButtons() {
@@ -72,13 +111,17 @@ void readButtons() {
     }
     
     pinStates[1] = enterVal;
+
+    if (btnStates[0] || btnStates[1] || enterVal == LOW) powerNoteActivity();
 }
 
 bool getButtonState(int btn) {
     return btnStates[btn];
 }
 
-void applySC8812AParams() {
+// --- I2C jobs (run on the bus task) ---
+
+bool configureSC8812AJob(void* ctx) {
     sc8812.setShuntResistors(5.0f, 5.0f);
     sc8812.setCellCount(3);
     sc8812.setSwitchingFrequency(0);
@@ -86,57 +129,40 @@ void applySC8812AParams() {
     sc8812.enableCurrentFoldback(false);
     sc8812.setCellVoltage((uint8_t)sc_charge_volt_index);
     sc8812.setIBATCurrentLimit(sc_ibat_limit);
+    return true;
 }
 
-void readSensors() {
-    static bool initiate = true;
-    if(initiate == true) {
-        initiate = false;
-        INA.begin();
-        INA.setMaxCurrentShunt(30.0, 0.005);
-        INA.setGain(4);
-        INA.setBusSamples(7);
-        INA.setShuntSamples(7);
-        ds18b20.begin();
-        ds18b20.requestTemperatures();
-        applySC8812AParams();
-        sc8812.enableADC(true);
-    }
-    vbat_read = INA.getBusVoltage();
-    ibat_read = INA.getCurrent();
-    if (ibat_read > -0.002 && ibat_read < 0.002) ibat_read = 0;
-    pbat_read = vbat_read * ibat_read;
-    vbus_read = sc8812.getVbusVoltage();
-    ibus_read = sc8812.getIbusCurrent();
-    pbus_read = vbus_read * ibus_read;
-    vcel_read = vbat_read / 4.0;
-    
-    if (millis() % 2000 < 100) ds18b20.requestTemperatures();
-    for (int i=0; i<4; i++) {
-        float t = ds18b20.getTempC(tempSensors[i]);
-        if (t > -50) tempReadings[i] = t;
-    }
-    
-    float v_comp = vbat_read + (ibat_read * -(cal_sag_comp / 10));
-    if (v_comp >= cal_max_soc_vcel * 4) soc = 100.0;
-    else if (v_comp <= cal_min_soc_vcel * 4) soc = 0.0;
-    else soc = ((v_comp - (cal_min_soc_vcel * 4)) / ((cal_max_soc_vcel * 4) - (cal_min_soc_vcel * 4))) * 100.0;
+bool sensorInitJob(void* ctx) {
+    bool ok = INA.begin();
+    INA.setMaxCurrentShunt(30.0, INA219_SHUNT_MOHM / 1000.0);
+    INA.setGain(4);
+    // continuous shunt + bus conversions, drained by the sampler
+    INA.setBusSamples(INA_AVG_SAMPLES_LOG2);
+    INA.setShuntSamples(INA_AVG_SAMPLES_LOG2);
+    sc8812.resync();
+    configureSC8812AJob(nullptr);
+    sc8812.enableADC(true);
+    return ok;
 }
 
-void executeShutdown() {
-    sc8812.enableADC(false);
-    digitalWrite(EN_5V, LOW);
-    esp_deep_sleep_enable_gpio_wakeup(1ULL << ENTER_PIN, ESP_GPIO_WAKEUP_GPIO_LOW);
-    esp_deep_sleep_start();
+bool sensorReadJob(void* ctx) {
+    sensorSample.seq = ++busReadSeq;
+    sensorSample.scValid = sc8812.readTelemetry(sensorSample.sc);
+    return true;
 }
 
-void applyPowerSettings() {
-    digitalWrite(EN_USB, qm_usb_out);
-    digitalWrite(EN_AC, qm_ac_out);
-    
+// sensorSample belongs to the sensing task again once this clears
+void sensorReadDone(void* ctx, bool ok) {
+    sensorJobBusy = false;
+}
+
+bool powerSettingsJob(void* ctx) {
     sc8812.disablePower();
-    mpptActive = false;
-    
+    if (protectTripped()) return true;
+
+    // converter may have browned out since the last change, restore its config before re-enabling
+    if (!sc8812.verify()) configureSC8812AJob(nullptr);
+
     if (qm_dc_mode_index == 1) { 
         sc8812.setVBUSVoltage(qm_dc_vbus);
         sc8812.setIBUSCurrentLimit(qm_dc_ibus);
@@ -146,82 +172,239 @@ void applyPowerSettings() {
         sc8812.setIBUSCurrentLimit(qm_dc_ibus);
         sc8812.enableCharge();
     } else if (qm_dc_mode_index == 3) {
-        mpptActive = true;
         sc8812.setIBUSCurrentLimit(qm_dc_ibus);
         sc8812.enableCharge();
     }
+    // the sensing task can trip while we are enabling; its PSTOP write may
+    // have been overridden, so put it back
+    if (protectTripped()) sc8812.disablePower();
+    return true;
+}
+
+bool mpptSetpointJob(void* ctx) {
+    sc8812.setMinVBUSMillivolts((uint16_t)mpptTargetMv);
+    return true;
+}
+
+// jobs run in order on the bus task, so the next read issued sees the new operating point
+void mpptSetpointDone(void* ctx, bool ok) {
+    mpptSettledSeq = busReadSeq + 1;
+}
+
+bool shutdownJob(void* ctx) {
+    return sc8812.enableADC(false);
+}
+
+void applySC8812AParams() {
+    i2cSubmit(I2C_PRIO_CONTROL, configureSC8812AJob);
 }
 
-void setupWiFi(int mode) {
-    if (mode == currentWifiState) return;
+void readSensors() {
+    static bool initiate = true;
+    if(initiate == true) {
+        initiate = false;
+        ds18b20.begin();
+        ds18b20.setWaitForConversion(false);
+        for (int i=0; i<4 && !resumeIsWarm(); i++) {
+            // resolution lives in the sensor's EEPROM, only rewrite it when it differs
+            if (ds18b20.getResolution(tempSensors[i]) != tempResolution[i]) {
+                ds18b20.setResolution(tempSensors[i], tempResolution[i]);
+            }
+        }
+        i2cRunSync(I2C_PRIO_CONTROL, sensorInitJob);
+        samplerStart();
+        socSetup();
+    }
+
+    int32_t chargeMaMs = 0;
+    if (samplerReadWindow(batWindow)) {
+        vbat_mv = batWindow.vbatMeanMv;
+        ibat_ma = batWindow.ibatMeanMa;
+        if (ibat_ma >= -2 && ibat_ma <= 2) ibat_ma = 0;
+        // mean current over the time the window covers, so reads lost to a
+        // busy bus or a full ring still count
+        else chargeMaMs = (int32_t)((int64_t)batWindow.ibatSumMa * batWindow.spanUs / ((int64_t)batWindow.count * 1000));
+        pbat_mw = vbat_mv * ibat_ma / 1000;
+        vcel_mv = vbat_mv / 4;
+        if (vbat_mv > 0) batteryValid = true;
+    }
+
+    // pick up the last SC8812A read and queue the next; a read still
+    // outstanding from the last tick is not queued twice
+    if (!sensorJobBusy) {
+        if (sensorSample.scValid) {
+            vbus_mv = sensorSample.sc.vbus_mV;
+            ibus_ma = sensorSample.sc.ibus_mA;
+            pbus_mw = vbus_mv * ibus_ma / 1000;
+            busSampleSeq = sensorSample.seq;
+            sensorSample.scValid = false;
+        }
+        sensorJobBusy = true;
+        if (!i2cSubmit(I2C_PRIO_SENSOR, sensorReadJob, sensorReadDone)) sensorJobBusy = false;
+    }
+
+    handleTemperatures();
     
-    WiFi.disconnect(true);
-    WiFi.persistent(false); 
-    WiFi.mode(WIFI_OFF);
-    delay(100);
-
-    if (mode == 1) {
-        WiFi.mode(WIFI_STA);
-        WiFi.begin(wifi_sta_ssid, wifi_sta_pass);
-        ArduinoOTA.begin();
-    } else if (mode == 2) {
-        WiFi.mode(WIFI_AP);
-        WiFi.softAP(wifi_ap_ssid, wifi_ap_pass);
-        delay(100); 
-        ArduinoOTA.begin();
+    // nothing measured yet on the first ticks after boot: leave the restored
+    // charge and the history alone instead of feeding them zeros
+    if (batteryValid) {
+        int32_t fullMv = toMilli(cal_max_soc_vcel) * 4;
+        int32_t voltageSoc = calcSocPermille(vbat_mv, ibat_ma, toMilli(cal_sag_comp) / 10,
+                                             toMilli(cal_min_soc_vcel) * 4, fullMv);
+        soc_permille = socUpdate(chargeMaMs, ibat_ma, vbat_mv, fullMv, voltageSoc);
+
+        int16_t hottest = INT16_MIN;
+        for (int i=0; i<4; i++) {
+            if (!isTempStale(i) && tempCenti[i] > hottest) hottest = tempCenti[i];
+        }
+        int16_t hist[HIST_CHANNELS];
+        hist[HIST_VBAT] = (int16_t)vbat_mv;
+        hist[HIST_IBAT] = (int16_t)ibat_ma;
+        hist[HIST_PBUS] = (int16_t)(pbus_mw / 100);
+        hist[HIST_TEMP] = (hottest == INT16_MIN) ? tempCenti[0] : hottest;
+        historyRecord(hist);
+    }
+
+    TelemetrySnapshot snap;
+    snap.takenAt = millis();
+    snap.vbat_mv = vbat_mv;
+    snap.ibat_ma = ibat_ma;
+    snap.pbat_mw = pbat_mw;
+    snap.vcel_mv = vcel_mv;
+    snap.soc_permille = soc_permille;
+    snap.tteMin = socTimeToEmptyMin();
+    snap.vbus_mv = vbus_mv;
+    snap.ibus_ma = ibus_ma;
+    snap.pbus_mw = pbus_mw;
+    snap.busSeq = busSampleSeq;
+    for (int i=0; i<4; i++) {
+        snap.tempCenti[i] = tempCenti[i];
+        snap.tempAtMs[i] = tempUpdatedAt[i];
+        snap.tempStale[i] = isTempStale(i);
+    }
+    telemetryPublish(snap);
+}
+
+// One shared conversion for all sensors, then one scratchpad read per tick once
+// that sensor's resolution allows, so the loop never blocks on more than one read
+void handleTemperatures() {
+    static bool converting = false;
+    static unsigned long convStart = 0;
+    static int next = 0;
+    unsigned long now = millis();
+
+    if (!converting) {
+        ds18b20.requestTemperatures(); // returns at once, wait-for-conversion is off
+        convStart = now;
+        next = 0;
+        converting = true;
+        return;
     }
-    currentWifiState = mode;
+
+    if (now - convStart < (unsigned long)ds18b20.millisToWaitForConversion(tempResolution[next])) return;
+
+    int32_t raw = ds18b20.getTemp(tempSensors[next]); // 1/128 C
+    if (raw > -50 * 128) {
+        tempCenti[next] = (int16_t)(raw * 100 / 128);
+        tempUpdatedAt[next] = now;
+        protectTemperature(next, tempCenti[next]);
+    }
+    if (++next >= 4) converting = false;
 }
 
-void handleNetwork() {
-    if (currentWifiState > 0) ArduinoOTA.handle();
+bool isTempStale(int i) {
+    return tempUpdatedAt[i] == 0 || millis() - tempUpdatedAt[i] > TEMP_STALE_MS;
 }
 
-long calcPWM(float temp, float minT, float maxT, int minP) {
-    if (temp < minT) return 0;
+int32_t calcSocPermille(int32_t vbatMv, int32_t ibatMa, int32_t sagMohm, int32_t minMv, int32_t maxMv) {
+    int32_t vComp = vbatMv - ibatMa * sagMohm / 1000;
+    if (vComp >= maxMv) return 1000;
+    if (vComp <= minMv) return 0;
+    return (vComp - minMv) * 1000 / (maxMv - minMv);
+}
 
-    if (temp >= maxT) return 100;
+void executeShutdown() {
+    i2cRunSync(I2C_PRIO_CONTROL, shutdownJob);
+    settingsFlush();
+    journalFlush();
+    socSave();
+    resumeSave();
+    digitalWrite(EN_5V, LOW);
+    esp_deep_sleep_enable_gpio_wakeup(1ULL << ENTER_PIN, ESP_GPIO_WAKEUP_GPIO_LOW);
+    esp_deep_sleep_start();
+}
 
-    return map((long)(temp * 100), (long)(minT * 100), (long)(maxT * 100), (long)minP, 100L);
+void applyPowerSettings() {
+    // a latched trip keeps everything off until the fault is cleared
+    protectSetOutputs(qm_usb_out, qm_ac_out);
+    
+    mpptActive = (qm_dc_mode_index == 3);
+    i2cSubmit(I2C_PRIO_CONTROL, powerSettingsJob);
 }
 
-void handleFanControl() {
+long calcPWM(int32_t tempC100, int32_t minC100, int32_t maxC100, int minP) {
+    if (tempC100 < minC100) return 0;
+
+    if (tempC100 >= maxC100) return 100;
+
+    return map(tempC100, minC100, maxC100, (long)minP, 100L);
+}
+
+int calcFanPercent(long pwm, int minP) {
+    if (pwm <= 0) return 0;
+    if (pwm >= 100) return 100;
+    int range = 100 - minP;
+    if (range <= 0) return 100;
+    return constrain((int)((pwm - minP) * 100 / range), 1, 100);
+}
+
+void handleFanControl(const TelemetrySnapshot& t) {
     static unsigned long startT = 0;
 
-    if (fan_test_startup) {
+    if (fan_test_startup && !resumeIsWarm()) {
         if (startT == 0) startT = millis();
         if (millis() - startT < 2000) {
             ledcWrite(0, 255);
-            fanSpeed = 1.0;
+            fanPercent = 100;
             return;
         }
     }
 
-    long pwmBat = calcPWM(tempReadings[0], tbat_min, tbat_max, fan_min_pwm);
-    long pwmMod = calcPWM(max(tempReadings[1], tempReadings[2]), tmod_min, tmod_max, fan_min_pwm);
-    long pwmInv = calcPWM(tempReadings[3], tinv_min, tinv_max, fan_min_pwm);
-    
-    long pwm = max(pwmBat, max(pwmMod, pwmInv));
-    ledcWrite(0, (int)(pwm * 2.55));
-
-    if (pwm > 0) {
-        if (pwm >= 100) {
-            fanSpeed = 1.0;
-        } else {
-            float range = 100.0 - (float)fan_min_pwm;
-            if (range > 0) {
-                fanSpeed = ((float)pwm - (float)fan_min_pwm) / range;
-                fanSpeed = constrain(fanSpeed, 0.01, 1.0); 
-            } else {
-                fanSpeed = 1.0;
-            }
+    static FanZone zones[FAN_ZONES] = {};
+    static int32_t demand = 0;
+    static unsigned long lastRun = 0;
+    unsigned long now = millis();
+    uint32_t dt = (lastRun == 0) ? 0 : now - lastRun;
+    lastRun = now;
+
+    // the two module sensors share a zone, the hotter fresh one counts
+    int32_t tmod = INT32_MIN;
+    uint32_t tmodAt = 0;
+    for (int i=1; i<=2; i++) {
+        if (!t.tempStale[i] && t.tempCenti[i] > tmod) {
+            tmod = t.tempCenti[i];
+            tmodAt = t.tempAtMs[i];
         }
-    } else {
-        fanSpeed = 0.0;
     }
+    bool tmodStale = (tmod == INT32_MIN);
+
+    FanZoneConfig cfgBat = {toCenti(tbat_min), toCenti(tbat_max), 400000};
+    FanZoneConfig cfgMod = {toCenti(tmod_min), toCenti(tmod_max), 100000};
+    FanZoneConfig cfgInv = {toCenti(tinv_min), toCenti(tinv_max), 300000};
+
+    int32_t target = fanZoneUpdate(zones[FAN_ZONE_TBAT], cfgBat, t.tempCenti[0], t.tempAtMs[0], t.tempStale[0], t.pbat_mw, dt);
+    target = max(target, fanZoneUpdate(zones[FAN_ZONE_TMOD], cfgMod, tmod, tmodAt, tmodStale, t.pbus_mw, dt));
+    target = max(target, fanZoneUpdate(zones[FAN_ZONE_TINV], cfgInv, t.tempCenti[3], t.tempAtMs[3], t.tempStale[3],
+                                       qm_ac_out ? t.pbat_mw : 0, dt));
+
+    // a zone at its max bypasses the slew limit
+    demand = (target >= 1000) ? target : fanSlew(demand, target, dt);
+    int32_t duty = fanDutyPermille(demand, fan_min_pwm);
+    ledcWrite(0, (int)(duty * 255 / 1000));
+    fanPercent = (demand + 9) / 10;
 }
 
-void handleAutoPowerOff() {
+void handleAutoPowerOff(const TelemetrySnapshot& t) {
     static unsigned long lastAct = 0;
     if (!apo_enable) {
         apoCountingDown = false;
@@ -229,13 +412,13 @@ void handleAutoPowerOff() {
     }
     
     bool active = false;
-    float effective_thresh_a = (qm_ac_out ? apo_ac_thres : apo_curr_thres) / 1000.0;
+    int32_t effective_thresh_ma = qm_ac_out ? apo_ac_thres : apo_curr_thres;
 
-    if (ibat_read > 0.1 || abs(ibat_read) > effective_thresh_a) active = true;
+    if (t.ibat_ma > 100 || abs(t.ibat_ma) > effective_thresh_ma) active = true;
     if (btnStates[0] || btnStates[1] || btnStates[2]) active = true;
-    if (tempReadings[0] > tbat_min) active = true;
-    if (max(tempReadings[1], tempReadings[2]) > tmod_min) active = true;
-    if (tempReadings[3] > tinv_min) active = true;
+    if (t.tempCenti[0] > toCenti(tbat_min)) active = true;
+    if (max(t.tempCenti[1], t.tempCenti[2]) > toCenti(tmod_min)) active = true;
+    if (t.tempCenti[3] > toCenti(tinv_min)) active = true;
     
     if (active) {
         lastAct = millis();
@@ -247,21 +430,44 @@ void handleAutoPowerOff() {
     if (millis() - lastAct > (apo_delay * 60000)) executeShutdown();
 }
 
-void handleMPPT() {
-    if (!mpptActive) return;
-    static unsigned long lastRun = 0;
-    if (millis() - lastRun < (mppt_interval * 1000)) return;
-    lastRun = millis();
-    
-    static float targetV = mppt_start_volt;
-    static float lastP = 0;
-    float currP = vbus_read * ibus_read;
-    
-    if (currP < lastP) mppt_step = -mppt_step;
-    targetV += mppt_step;
-    targetV = constrain(targetV, mppt_min_volt, mppt_max_volt);
-    sc8812.setMinVBUSVoltage(targetV);
-    lastP = currP;
+void handleMPPT(const TelemetrySnapshot& t) {
+    static bool wasActive = false;
+    static uint32_t lastSeq = 0;
+    static uint32_t lastSweeps = 0;
+
+    MpptConfig cfg;
+    cfg.minMv = toMilli(mppt_min_volt);
+    cfg.maxMv = toMilli(mppt_max_volt);
+    cfg.startMv = toMilli(mppt_start_volt);
+    cfg.stepMv = toMilli(mppt_step);
+    cfg.intervalMs = (uint32_t)toMilli(mppt_interval);
+    cfg.sweepEveryMs = (uint32_t)mppt_sweep_min * 60000UL;
+    cfg.algorithm = mppt_algo_index;
+
+    if (!mpptActive) {
+        wasActive = false;
+        return;
+    }
+    if (!wasActive) {
+        wasActive = true;
+        mpptReset(cfg, millis());
+        lastSeq = t.busSeq;
+    }
+
+    // only act on a VBUS/IBUS pair read after the converter took the last setpoint
+    if (t.busSeq == lastSeq || (int32_t)(t.busSeq - mpptSettledSeq) < 0) return;
+    lastSeq = t.busSeq;
+
+    int32_t target;
+    if (mpptUpdate(cfg, t.vbus_mv, t.ibus_ma, millis(), target)) {
+        mpptTargetMv = target;
+        i2cSubmit(I2C_PRIO_CONTROL, mpptSetpointJob, mpptSetpointDone);
+    }
+
+    if (mpptStats.sweeps != lastSweeps) {
+        lastSweeps = mpptStats.sweeps;
+        logEvent(LOG_INFO, EV_MPPT_SWEEP, mpptStats.sweepVmpMv, mpptStats.sweepPmaxMw);
+    }
 }
 
 void handlePageScroll(bool up, bool down, bool enter) {
@@ -9,6 +9,9 @@
 #include <DallasTemperature.h>
 #include <SC8812A.h>
 #include "config.h"
+#include "fixedpoint.h"
+#include "sampler.h"
+#include "telemetry.h"
 
 #define PSTOP_PIN 8
 #define SDA_PIN 6
@@ -21,14 +24,16 @@
 #define EN_AC 10
 #define FAN_PIN 20
 #define INA219_ADDR 0x40
+#define INA219_SHUNT_MOHM 5
 #define DS18B20_PIN 0
 
-extern float vbat, ibat, soc;
-extern float vbat_read, ibat_read, pbat_read;
-extern float vbus_read, ibus_read, pbus_read;
-extern float vcel_read;
-extern float tempReadings[4];
-extern float fanSpeed;
+extern int32_t soc_permille;
+extern int32_t vbat_mv, ibat_ma, pbat_mw;
+extern int32_t vbus_mv, ibus_ma, pbus_mw;
+extern int32_t vcel_mv;
+extern int16_t tempCenti[4];
+extern int fanPercent;
+extern SampleWindow batWindow;
 extern bool mpptActive;
 extern bool apoCountingDown;
 
@@ -37,13 +42,17 @@ void readButtons();
 bool getButtonState(int btn); 
 void applySC8812AParams();
 void readSensors();
-void handleFanControl();
-void handleAutoPowerOff();
-void handleMPPT();
-void handleNetwork();
+void handleTemperatures();
+bool isTempStale(int i);
+void handleFanControl(const TelemetrySnapshot& t);
+void handleAutoPowerOff(const TelemetrySnapshot& t);
+void handleMPPT(const TelemetrySnapshot& t);
 void executeShutdown();
 void applyPowerSettings();
-void setupWiFi(int mode);
 void handlePageScroll(bool up, bool down, bool enter);
 
+int32_t calcSocPermille(int32_t vbatMv, int32_t ibatMa, int32_t sagMohm, int32_t minMv, int32_t maxMv);
+long calcPWM(int32_t tempC100, int32_t minC100, int32_t maxC100, int minP);
+int calcFanPercent(long pwm, int minP);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,169 @@
+#include "tasks.h"
+#include "config.h"
+#include "display.h"
+#include "system.h"
+#include "telemetry.h"
+#include "profiler.h"
+#include "protect.h"
+#include "power.h"
+#include "settings.h"
+#include "journal.h"
+#include "web.h"
+#include "telemstream.h"
+#include "wifimgr.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+TaskTiming taskTimings[TASK_COUNT] = {
+    {"control", 100},
+    {"sensing", 100},
+    {"ui", 20},
+    {"display", 20},
+    {"network", 50}
+};
+
+typedef void (*TaskBody)();
+
+struct TaskDef {
+    AppTask id;
+    TaskBody body;
+    ProfilePoint lateness;
+    uint32_t stack;
+    UBaseType_t prio;
+};
+
+// Fixed-rate loop around a task body. Lateness is measured from the tick the
+// task was due on, so it shows scheduling jitter rather than drift.
+static void periodicTask(void* arg) {
+    const TaskDef* def = (const TaskDef*)arg;
+    TaskTiming& tm = taskTimings[def->id];
+    const TickType_t period = pdMS_TO_TICKS(tm.periodMs);
+
+    TickType_t wake = xTaskGetTickCount();
+    const TickType_t tick0 = wake;
+    const uint32_t us0 = micros();
+
+    for (;;) {
+        vTaskDelayUntil(&wake, period);
+        uint32_t start = micros();
+        uint32_t due = us0 + (uint32_t)(wake - tick0) * portTICK_PERIOD_MS * 1000;
+        int32_t late = (int32_t)(start - due);
+        if (late > (int32_t)tm.maxLateUs) tm.maxLateUs = late;
+        profRecordUs(def->lateness, late > 0 ? (uint32_t)late : 0);
+        if (def->id == TASK_CONTROL) powerRecordWake(late > 0 ? (uint32_t)late : 0);
+
+        def->body();
+
+        uint32_t run = micros() - start;
+        if (run > tm.maxRunUs) tm.maxRunUs = run;
+        tm.runs++;
+    }
+}
+
+static void controlBody() {
+    TelemetrySnapshot t;
+    telemetryRead(t);
+
+    uint32_t t0 = profStart();
+    handleMPPT(t);
+    profEnd(PROF_MPPT, t0);
+
+    t0 = profStart();
+    handleAutoPowerOff(t);
+    profEnd(PROF_APO, t0);
+
+    t0 = profStart();
+    handleFanControl(t);
+    profEnd(PROF_FAN, t0);
+
+    protectService();
+
+    powerUpdate(fanPercent > 0);
+}
+
+static void sensingBody() {
+    uint32_t t0 = profStart();
+    readSensors();
+    profEnd(PROF_SENSORS, t0);
+}
+
+static void uiBody() {
+    readButtons();
+    handleMenuLogic();
+    uiPublish();
+    settingsService();
+}
+
+static void displayBody() {
+    displayService();
+}
+
+// "s<mA>,<mV>" feeds the protection path a simulated battery sample until a
+// bare "s"; the voltage defaults to 16 V
+static void simulateCommand(const char* arg) {
+    if (!*arg) {
+        protectSimulate(false);
+        Serial.println("Simulation off");
+        return;
+    }
+    char* end;
+    long ma = strtol(arg, &end, 10);
+    long mv = (*end == ',') ? strtol(end + 1, nullptr, 10) : 16000;
+    protectSimulate(true, ma, mv);
+    Serial.printf("Simulating %ldmA %ldmV\n", ma, mv);
+}
+
+// t: timing dump, T: dump and reset, j: journal dump, f: fault log,
+// b/B: binary stream on/off, s...: simulated battery sample (see above)
+static void handleSerialCommands() {
+    static char arg[24];
+    static int argLen = -1; // collecting an 's' argument up to the end of the line
+    while (Serial.available()) {
+        int c = Serial.read();
+        if (argLen >= 0) {
+            if (c == '\n' || c == '\r') {
+                arg[argLen] = '\0';
+                simulateCommand(arg);
+                argLen = -1;
+            } else if (argLen < (int)sizeof(arg) - 1) {
+                arg[argLen++] = (char)c;
+            }
+            continue;
+        }
+        if (c == 's') argLen = 0;
+        if (c == 'f') faultDump(Serial);
+        if (c == 't' || c == 'T') profDump(Serial);
+        if (c == 'T') profReset();
+        if (c == 'j') journalDump(Serial);
+        if (c == 'b' || c == 'B') streamSerial(c == 'b');
+    }
+}
+
+static void networkBody() {
+    uint32_t t0 = profStart();
+    wifiService();
+    profEnd(PROF_NETWORK, t0);
+    webService();
+    t0 = profStart();
+    streamService();
+    profEnd(PROF_STREAM, t0);
+    journalService();
+    handleSerialCommands();
+}
+
+static const TaskDef taskDefs[TASK_COUNT] = {
+    {TASK_CONTROL, controlBody, PROF_LATE_CONTROL, 4096, TASK_PRIO_CONTROL},
+    {TASK_SENSING, sensingBody, PROF_LATE_SENSING, 4096, TASK_PRIO_SENSING},
+    {TASK_UI, uiBody, PROF_LATE_UI, 4096, TASK_PRIO_UI},
+    {TASK_DISPLAY, displayBody, PROF_LATE_DISPLAY, 6144, TASK_PRIO_DISPLAY},
+    {TASK_NETWORK, networkBody, PROF_LATE_NETWORK, 4096, TASK_PRIO_NETWORK}
+};
+
+void tasksStart() {
+    // sensing first so control's first snapshot is populated
+    readSensors();
+    uiPublish();
+    for (int i = 0; i < TASK_COUNT; i++) {
+        xTaskCreate(periodicTask, taskTimings[i].name, taskDefs[i].stack, (void*)&taskDefs[i], taskDefs[i].prio, nullptr);
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef TASKS_H
+#define TASKS_H
+
+#include <Arduino.h>
+
+// Application tasks. Control preempts everything else, so OLED transfers,
+// OneWire reads and Wi-Fi/OTA can no longer delay it. Sensing publishes a
+// TelemetrySnapshot that control and the display read.
+// (The sampler task runs at 3 and the I2C bus task at 2.)
+
+#define TASK_PRIO_CONTROL 5
+#define TASK_PRIO_SENSING 3
+#define TASK_PRIO_UI 2
+#define TASK_PRIO_DISPLAY 1
+#define TASK_PRIO_NETWORK 1
+
+enum AppTask {
+    TASK_CONTROL,   // 100 ms: MPPT, APO, fan
+    TASK_SENSING,   // 100 ms: INA219 window, SC8812A, DS18B20, SOC
+    TASK_UI,        // 20 ms: buttons and menu, publishes a UiSnapshot
+    TASK_DISPLAY,   // 20 ms: render and flip at the adaptive frame rate
+    TASK_NETWORK,   // 50 ms: Wi-Fi link, OTA, web pushes, telemetry stream, journal writes
+    TASK_COUNT
+};
+
+struct TaskTiming {
+    const char* name;
+    uint32_t periodMs;
+    uint32_t runs;
+    uint32_t maxLateUs;  // wake-up after the scheduled release
+    uint32_t maxRunUs;
+};
+
+extern TaskTiming taskTimings[TASK_COUNT];
+
+void tasksStart();
+
+#endif
@@ -0,0 +1,21 @@
+#include "telemetry.h"
+
+TelemetrySnapshot telemetrySlots[2] = {};
+volatile uint32_t telemetrySeq = 0;  // published count, the live slot is seq & 1
+
+void telemetryPublish(const TelemetrySnapshot& s) {
+    uint32_t next = telemetrySeq + 1;
+    telemetrySlots[next & 1] = s;
+    __sync_synchronize();
+    telemetrySeq = next;
+}
+
+void telemetryRead(TelemetrySnapshot& s) {
+    uint32_t seq;
+    do {
+        seq = telemetrySeq;
+        __sync_synchronize();
+        s = telemetrySlots[seq & 1];
+        __sync_synchronize();
+    } while (telemetrySeq != seq); // a publish writes its slot before bumping seq, so any change may be torn
+}
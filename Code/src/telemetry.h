@@ -0,0 +1,26 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <Arduino.h>
+
+// Consistent copy of the sensing task's results for the other tasks.
+// Double buffered: the writer fills the idle slot and then flips the index, so
+// a higher priority reader never waits and a lower priority one retries at most
+// when a publish lands mid-copy.
+
+struct TelemetrySnapshot {
+    uint32_t takenAt;    // millis()
+    int32_t vbat_mv, ibat_ma, pbat_mw, vcel_mv;
+    int32_t soc_permille;
+    int32_t tteMin;      // time to empty at the recent discharge rate, -1 when not discharging
+    int32_t vbus_mv, ibus_ma, pbus_mw;
+    uint32_t busSeq;     // SC8812A read the VBUS/IBUS pair came from
+    int16_t tempCenti[4];
+    uint32_t tempAtMs[4];  // millis() of each sensor's last reading
+    bool tempStale[4];
+};
+
+void telemetryPublish(const TelemetrySnapshot& s);
+void telemetryRead(TelemetrySnapshot& s);
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef TELEMFRAME_H
+#define TELEMFRAME_H
+
+#include <stdint.h>
+
+// Binary telemetry wire format, shared with the host decoder in tools/, so
+// this header must not pull in anything Arduino. All fields little endian.
+//
+//   TelemFrameHeader | count x recordSize bytes | uint32 CRC-32
+//
+// The CRC (crc32.h) covers the header and the records. A decoder hunts for
+// the sync bytes and trusts a frame only once its CRC checks out, so frames
+// survive being interleaved with text on the serial console. Records only
+// ever grow at the end: recordSize lets an older decoder skip fields it does
+// not know, and version changes only when existing fields change meaning.
+
+#define TELEM_SYNC0 0xA5
+#define TELEM_SYNC1 0x5A
+#define TELEM_VERSION 1
+#define TELEM_MAX_RECORDS 32       // per frame, bounds a decoder's buffer
+#define TELEM_UDP_PORT 5760        // a datagram here subscribes its sender
+
+// status bits
+#define TS_USB 0x0001
+#define TS_AC 0x0002
+#define TS_DC_MODE_SHIFT 2         // 2 bits: OFF, OUT, IN, MPPT
+#define TS_FAULT 0x0010            // protection tripped, outputs latched off
+#define TS_APO 0x0020              // auto power off counting down
+#define TS_STALE_SHIFT 8           // 4 bits: temperature probe i has no fresh reading
+
+struct __attribute__((packed)) TelemFrameHeader {
+    uint8_t sync[2];
+    uint8_t version;
+    uint8_t recordSize;
+    uint16_t seq;          // per frame, gaps mean frames lost in transit
+    uint8_t count;
+    uint8_t lost;          // samples dropped on the device since the last frame, saturates
+};
+
+struct __attribute__((packed)) TelemRecord {
+    uint32_t timeUs;       // INA219 sample time, micros(); wraps after ~71 minutes
+    uint16_t vbatMv;       // VBAT/IBAT at the sample rate
+    int16_t ibatMa;
+    uint16_t vbusMv;       // the rest as of the last 100 ms sensing pass
+    int16_t ibusMa;
+    int16_t tempCenti[4];
+    uint16_t socPermille;
+    uint8_t fanPercent;
+    uint16_t status;       // TS_*
+};
+
+#endif
@@ -0,0 +1,176 @@
+#include "telemstream.h"
+#include "config.h"
+#include "system.h"
+#include "protect.h"
+#include "power.h"
+#include "crc32.h"
+#include <WiFiUdp.h>
+
+StreamStats streamStats;
+
+// Rates offered by the menu, as whole divisors of the INA219 sample rate
+static const uint16_t rateHz[] = {10, 20, 50, 100, 200};
+static const int RATE_COUNT = sizeof(rateHz) / sizeof(rateHz[0]);
+
+struct QueuedSample {
+    uint32_t atUs;
+    uint16_t vbatMv;
+    int16_t ibatMa;
+};
+
+// Same single-producer ring as the sampler: head is only written by the bus
+// task, tail only by the network task.
+QueuedSample streamQueue[STREAM_QUEUE_SIZE];
+volatile uint32_t queueHead = 0;
+volatile uint32_t queueTail = 0;
+volatile uint32_t queueLost = 0;
+volatile bool sampling = false;
+uint32_t decimate = 0;
+
+uint8_t frameBuf[sizeof(TelemFrameHeader) + STREAM_BATCH * sizeof(TelemRecord) + sizeof(uint32_t)];
+int pending = 0;
+uint32_t pendingSinceMs = 0;
+uint16_t frameSeq = 0;
+uint32_t lostReported = 0;
+
+bool serialOn = false;
+WiFiUDP streamUdp;
+bool udpOpen = false;
+bool udpSubscribed = false;
+IPAddress subscriberIp;
+uint16_t subscriberPort = 0;
+uint32_t leaseMs = 0;
+
+int streamRateHz() {
+    return rateHz[constrain(stream_rate_index, 0, RATE_COUNT - 1)];
+}
+
+bool streamActive() {
+    return serialOn || udpSubscribed;
+}
+
+// Bus task, once per INA219 reading
+void streamSample(uint16_t vbatMv, int16_t ibatMa, uint32_t atUs) {
+    if (!sampling) return;
+    uint32_t divisor = 1000 / INA_SAMPLE_PERIOD_MS / streamRateHz();
+    if (++decimate < divisor) return;
+    decimate = 0;
+
+    if (queueHead - queueTail >= STREAM_QUEUE_SIZE) {
+        queueLost = queueLost + 1;
+        return;
+    }
+    QueuedSample& q = streamQueue[queueHead & (STREAM_QUEUE_SIZE - 1)];
+    q.atUs = atUs;
+    q.vbatMv = vbatMv;
+    q.ibatMa = ibatMa;
+    __sync_synchronize(); // publish the sample before the index
+    queueHead = queueHead + 1;
+}
+
+void streamSerial(bool on) {
+    serialOn = on;
+}
+
+void streamUdpBegin() {
+    if (udpOpen) return;
+    udpOpen = streamUdp.begin(TELEM_UDP_PORT);
+}
+
+// Any datagram (re)subscribes its sender; the payload is ignored
+static void pollUdp() {
+    if (!udpOpen) return;
+    while (streamUdp.parsePacket() > 0) {
+        subscriberIp = streamUdp.remoteIP();
+        subscriberPort = streamUdp.remotePort();
+        leaseMs = millis();
+        udpSubscribed = true;
+    }
+    if (udpSubscribed && millis() - leaseMs > STREAM_UDP_LEASE_MS) udpSubscribed = false;
+}
+
+static uint16_t statusBits(const TelemetrySnapshot& t) {
+    uint16_t s = 0;
+    if (qm_usb_out) s |= TS_USB;
+    if (qm_ac_out) s |= TS_AC;
+    s |= (qm_dc_mode_index & 3) << TS_DC_MODE_SHIFT;
+    if (protectTripped()) s |= TS_FAULT;
+    if (apoCountingDown) s |= TS_APO;
+    for (int i = 0; i < 4; i++) {
+        if (t.tempStale[i]) s |= 1 << (TS_STALE_SHIFT + i);
+    }
+    return s;
+}
+
+static void sendFrame() {
+    TelemFrameHeader* h = (TelemFrameHeader*)frameBuf;
+    h->sync[0] = TELEM_SYNC0;
+    h->sync[1] = TELEM_SYNC1;
+    h->version = TELEM_VERSION;
+    h->recordSize = sizeof(TelemRecord);
+    h->seq = frameSeq++;
+    h->count = pending;
+    uint32_t lost = queueLost;
+    h->lost = (uint8_t)min(lost - lostReported, (uint32_t)255);
+    streamStats.lost = lostReported = lost;
+
+    size_t len = sizeof(TelemFrameHeader) + pending * sizeof(TelemRecord);
+    uint32_t crc = crc32(frameBuf, len);
+    memcpy(frameBuf + len, &crc, sizeof(crc));
+    len += sizeof(crc);
+
+    // never block the network task on a slow host: skip the frame instead
+    if (serialOn) {
+        if (Serial.availableForWrite() >= (int)len) Serial.write(frameBuf, len);
+        else streamStats.skipped++;
+    }
+    if (udpSubscribed) {
+        streamUdp.beginPacket(subscriberIp, subscriberPort);
+        streamUdp.write(frameBuf, len);
+        if (!streamUdp.endPacket()) streamStats.skipped++;
+    }
+
+    streamStats.frames++;
+    streamStats.records += pending;
+    streamStats.bytes += len;
+    pending = 0;
+}
+
+void streamService() {
+    pollUdp();
+    if (!streamActive()) {
+        sampling = false;
+        queueTail = queueHead;
+        pending = 0;
+        return;
+    }
+    sampling = true;
+    powerNoteActivity(); // no light sleep or slow clock under a running stream
+
+    TelemetrySnapshot t;
+    telemetryRead(t);
+    uint16_t status = statusBits(t);
+
+    uint32_t head = queueHead;
+    __sync_synchronize();
+    for (uint32_t tail = queueTail; tail != head; tail++) {
+        const QueuedSample& q = streamQueue[tail & (STREAM_QUEUE_SIZE - 1)];
+        if (pending == 0) pendingSinceMs = millis();
+
+        TelemRecord* r = (TelemRecord*)(frameBuf + sizeof(TelemFrameHeader)) + pending;
+        r->timeUs = q.atUs;
+        r->vbatMv = q.vbatMv;
+        r->ibatMa = q.ibatMa;
+        r->vbusMv = (uint16_t)t.vbus_mv;
+        r->ibusMa = (int16_t)t.ibus_ma;
+        for (int i = 0; i < 4; i++) r->tempCenti[i] = t.tempCenti[i];
+        r->socPermille = (uint16_t)t.soc_permille;
+        r->fanPercent = (uint8_t)fanPercent;
+        r->status = status;
+
+        if (++pending == STREAM_BATCH) sendFrame();
+    }
+    queueTail = head;
+
+    if (pending > 0 && millis() - pendingSinceMs >= STREAM_HOLD_MS) sendFrame();
+}
@@ -0,0 +1,39 @@
+#ifndef TELEMSTREAM_H
+#define TELEMSTREAM_H
+
+#include <Arduino.h>
+#include "telemframe.h"
+
+// High-rate binary telemetry, wire format in telemframe.h. The INA219 sampler
+// offers every reading and those on the configured rate are queued with their
+// timestamp. The network task merges them with the latest sensing snapshot
+// and packs them into frames, sent once STREAM_BATCH records are in or the
+// oldest has waited STREAM_HOLD_MS.
+// Sinks: the serial console after a 'b' command (until 'B'), and the last
+// host to send a datagram to TELEM_UDP_PORT, until it has been quiet for
+// STREAM_UDP_LEASE_MS. A sink without room for a whole frame skips it.
+
+#define STREAM_BATCH 10
+#define STREAM_HOLD_MS 250
+#define STREAM_UDP_LEASE_MS 10000
+#define STREAM_QUEUE_SIZE 128      // power of two, 640 ms at the full rate
+#define STREAM_SERIAL_TX_BUFFER 1024
+
+struct StreamStats {
+    uint32_t frames;
+    uint32_t records;
+    uint32_t lost;       // samples that found the queue full
+    uint32_t skipped;    // frames a sink had no room for
+    uint32_t bytes;
+};
+
+extern StreamStats streamStats;
+
+void streamSample(uint16_t vbatMv, int16_t ibatMa, uint32_t atUs);
+void streamSerial(bool on);
+void streamUdpBegin();
+void streamService();
+int streamRateHz();
+bool streamActive();
+
+#endif
@@ -0,0 +1,151 @@
+#include "web.h"
+#include "webjson.h"
+#include "config.h"
+#include "system.h"
+#include "statuslog.h"
+#include "profiler.h"
+#include "mppt.h"
+#include <ESPAsyncWebServer.h>
+#include <ESPmDNS.h>
+
+AsyncWebServer server(80);
+AsyncEventSource events("/events");
+bool webStarted = false;
+
+static const char dashboardHtml[] PROGMEM = R"html(<!DOCTYPE html><html><head>
+<meta name="viewport" content="width=device-width"><title>Omnibus 4X8</title>
+<style>body{font:14px monospace;margin:1em}td{padding:2px 8px}#log{white-space:pre}</style></head>
+<body><h3>Omnibus 4X8</h3><table id="tab"></table><h4>Log</h4><div id="log"></div><script>
+var u={vbat:[1e3,'V',2],ibat:[1e3,'A',2],pbat:[1e3,'W',1],vcel:[1e3,'V',2],soc:[10,'%',0],vbus:[1e3,'V',2],
+ibus:[1e3,'A',2],pbus:[1e3,'W',1],t0:[100,'C',1],t1:[100,'C',1],t2:[100,'C',1],t3:[100,'C',1],fan:[1,'%',0],tte:[1,'min',0],
+mppt_eff:[10,'%',1],mppt_wh:[1e3,'Wh',2]};
+function show(d){for(var k in d){var r=document.getElementById(k);if(!r){r=tab.insertRow();r.id=k;
+r.insertCell().textContent=k;r.insertCell();}var f=u[k]||[1,'',0];
+r.cells[1].textContent=d[k]===null?'--':(d[k]/f[0]).toFixed(f[2])+f[1];}}
+function logs(d){d.log.forEach(function(e){log.textContent=e.msg+'\n'+log.textContent;});}
+var es=new EventSource('/events');
+es.addEventListener('full',function(e){show(JSON.parse(e.data));});
+es.addEventListener('delta',function(e){show(JSON.parse(e.data));});
+es.addEventListener('log',function(e){logs(JSON.parse(e.data));});
+fetch('/api/log').then(function(r){return r.json();}).then(logs);
+</script></body></html>)html";
+
+static WebExtras readExtras() {
+    WebExtras x;
+    x.fanPercent = fanPercent;
+    x.mpptEffPermille = mpptStats.sweepPmaxMw > 0 ? mpptStats.efficiencyPermille : -1;
+    x.mpptHarvestedMwh = mpptStats.harvestedMwh;
+    return x;
+}
+
+// log records from fromSeq on, as many as fit; nextSeq is where to resume
+static int logJson(uint32_t fromSeq, uint32_t& nextSeq, char* out, size_t len) {
+    uint32_t seq = max(fromSeq, logFirstSeq());
+    uint32_t end = logEndSeq();
+    int pos = snprintf(out, len, "{\"log\":[");
+    bool first = true;
+    for (; seq < end; seq++) {
+        const LogRecord* r = logGet(seq);
+        if (!r) continue;
+        char msg[LOG_LINE_LEN];
+        logFormatMessage(*r, msg, sizeof(msg));
+        uint32_t atMs = r->atMs;
+        uint8_t sev = r->severity;
+        if (!logValid(r, seq)) continue;
+
+        // messages are plain ASCII without quotes, so no escaping is needed
+        char entry[96];
+        int n = snprintf(entry, sizeof(entry), "%s{\"seq\":%lu,\"t\":%lu,\"sev\":%u,\"msg\":\"%s\"}", first ? "" : ",",
+                         (unsigned long)seq, (unsigned long)atMs, sev, msg);
+        if (pos + n + 32 >= (int)len) break; // room for the closing part
+        memcpy(out + pos, entry, n);
+        pos += n;
+        first = false;
+    }
+    nextSeq = seq;
+    pos += snprintf(out + pos, len - pos, "],\"next\":%lu}", (unsigned long)nextSeq);
+    return pos;
+}
+
+static void sendTelemetry(AsyncWebServerRequest* req) {
+    uint32_t t0 = profStart();
+    char body[WEB_JSON_MAX];
+    TelemetrySnapshot t;
+    telemetryRead(t);
+    webTelemetryJson(t, readExtras(), body, sizeof(body));
+    req->send(200, "application/json", body);
+    profEnd(PROF_HTTP, t0);
+}
+
+static void sendLog(AsyncWebServerRequest* req) {
+    uint32_t t0 = profStart();
+    char body[WEB_JSON_MAX];
+    uint32_t from = req->hasParam("from") ? (uint32_t)req->getParam("from")->value().toInt() : 0;
+    uint32_t next;
+    logJson(from, next, body, sizeof(body));
+    req->send(200, "application/json", body);
+    profEnd(PROF_HTTP, t0);
+}
+
+void webStart() {
+    if (webStarted) return;
+
+    // "omnibus.local" -> "omnibus"
+    char host[32];
+    snprintf(host, sizeof(host), "%s", web_address);
+    char* dot = strchr(host, '.');
+    if (dot) *dot = '\0';
+    if (MDNS.begin(host)) MDNS.addService("http", "tcp", 80);
+
+    server.on("/", HTTP_GET, [](AsyncWebServerRequest* req) { req->send(200, "text/html", dashboardHtml); });
+    server.on("/api/telemetry", HTTP_GET, sendTelemetry);
+    server.on("/api/log", HTTP_GET, sendLog);
+    events.onConnect([](AsyncEventSourceClient* client) {
+        char body[WEB_JSON_MAX];
+        TelemetrySnapshot t;
+        telemetryRead(t);
+        webTelemetryJson(t, readExtras(), body, sizeof(body));
+        client->send(body, "full", millis());
+    });
+    server.addHandler(&events);
+    server.onNotFound([](AsyncWebServerRequest* req) { req->send(404); });
+    server.begin();
+    webStarted = true;
+}
+
+void webService() {
+    static unsigned long lastPush = 0;
+    static TelemetrySnapshot last;
+    static WebExtras lastX;
+    static uint32_t logSeq = 0;
+    static bool streaming = false;
+
+    if (!webStarted || events.count() == 0) {
+        streaming = false;
+        return;
+    }
+    unsigned long now = millis();
+    if (now - lastPush < WEB_PUSH_MS) return;
+    lastPush = now;
+
+    uint32_t t0 = profStart();
+    TelemetrySnapshot t;
+    telemetryRead(t);
+    WebExtras x = readExtras();
+    char body[WEB_JSON_MAX];
+    if (!streaming) {
+        // new clients got a full snapshot on connect and fetch the log themselves
+        streaming = true;
+        logSeq = logEndSeq();
+    } else if (webDeltaJson(t, x, last, lastX, body, sizeof(body)) > 0) {
+        events.send(body, "delta", now);
+    }
+    last = t;
+    lastX = x;
+
+    if (logSeq != logEndSeq()) {
+        logJson(logSeq, logSeq, body, sizeof(body));
+        events.send(body, "log", now);
+    }
+    profEnd(PROF_WEB, t0);
+}
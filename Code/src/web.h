@@ -0,0 +1,20 @@
+#ifndef WEB_H
+#define WEB_H
+
+#include <Arduino.h>
+
+// HTTP dashboard on port 80, announced over mDNS under web_address.
+//   /                 dashboard page, served from flash
+//   /api/telemetry    JSON snapshot
+//   /api/log?from=N   status log records from sequence N
+//   /events           SSE: "full" on connect, then "delta" and "log" pushes
+// Requests are handled on the AsyncTCP task, built at priority 1 (see
+// platformio.ini) so it sits under control and sensing. webService() runs on
+// the network task and pushes only the fields that changed.
+
+#define WEB_PUSH_MS 500
+
+void webStart();
+void webService();
+
+#endif
@@ -0,0 +1,68 @@
+#include "webjson.h"
+
+struct JsonField {
+    const char* key;
+    int32_t value;
+    bool valid;
+};
+
+const int JSON_FIELDS = 16;
+
+static void collect(const TelemetrySnapshot& t, const WebExtras& x, JsonField* f) {
+    static const char* tempKeys[4] = {"t0", "t1", "t2", "t3"};
+    f[0] = {"vbat", t.vbat_mv, true};
+    f[1] = {"ibat", t.ibat_ma, true};
+    f[2] = {"pbat", t.pbat_mw, true};
+    f[3] = {"vcel", t.vcel_mv, true};
+    f[4] = {"soc", t.soc_permille, true};
+    f[5] = {"vbus", t.vbus_mv, true};
+    f[6] = {"ibus", t.ibus_ma, true};
+    f[7] = {"pbus", t.pbus_mw, true};
+    for (int i = 0; i < 4; i++) f[8 + i] = {tempKeys[i], t.tempCenti[i], !t.tempStale[i]};
+    f[12] = {"fan", x.fanPercent, true};
+    f[13] = {"tte", t.tteMin, t.tteMin >= 0};
+    f[14] = {"mppt_eff", x.mpptEffPermille, x.mpptEffPermille >= 0};
+    f[15] = {"mppt_wh", (int32_t)x.mpptHarvestedMwh, true};
+}
+
+// appends, keeping pos <= len - 1 so a full buffer just truncates
+static void putField(char* out, size_t len, size_t& pos, bool comma, const JsonField& f) {
+    if (pos + 1 >= len) return;
+    int n = f.valid ? snprintf(out + pos, len - pos, "%s\"%s\":%ld", comma ? "," : "", f.key, (long)f.value)
+                    : snprintf(out + pos, len - pos, "%s\"%s\":null", comma ? "," : "", f.key);
+    if (n > 0) pos = min(pos + n, len - 1);
+}
+
+static int writeFields(const JsonField* f, const bool* include, char* out, size_t len) {
+    size_t pos = 0;
+    int count = 0;
+    out[pos++] = '{';
+    for (int i = 0; i < JSON_FIELDS; i++) {
+        if (!include[i]) continue;
+        putField(out, len, pos, count > 0, f[i]);
+        count++;
+    }
+    if (pos + 1 < len) out[pos++] = '}';
+    out[pos] = '\0';
+    return count ? (int)pos : 0;
+}
+
+int webTelemetryJson(const TelemetrySnapshot& t, const WebExtras& x, char* out, size_t len) {
+    JsonField f[JSON_FIELDS];
+    bool all[JSON_FIELDS];
+    collect(t, x, f);
+    for (int i = 0; i < JSON_FIELDS; i++) all[i] = true;
+    return writeFields(f, all, out, len);
+}
+
+int webDeltaJson(const TelemetrySnapshot& t, const WebExtras& x, const TelemetrySnapshot& last, const WebExtras& lastX,
+                 char* out, size_t len) {
+    JsonField now[JSON_FIELDS], before[JSON_FIELDS];
+    bool changed[JSON_FIELDS];
+    collect(t, x, now);
+    collect(last, lastX, before);
+    for (int i = 0; i < JSON_FIELDS; i++) {
+        changed[i] = now[i].valid != before[i].valid || (now[i].valid && now[i].value != before[i].value);
+    }
+    return writeFields(now, changed, out, len);
+}
@@ -0,0 +1,27 @@
+#ifndef WEBJSON_H
+#define WEBJSON_H
+
+#include <Arduino.h>
+#include "telemetry.h"
+
+// Telemetry JSON for the web server, written with snprintf into caller
+// buffers. Only snapshot fields are read, so this builds and runs on a host
+// (test/test_webjson). Values stay in the telemetry's integer units (mV, mA,
+// mW, mWh, permille, centi-C, minutes); a stale temperature or an unknown
+// time to empty is null.
+
+#define WEB_JSON_MAX 768
+
+// Values from outside the sensing snapshot
+struct WebExtras {
+    int fanPercent;
+    int32_t mpptEffPermille;    // -1 until an MPPT sweep has found a reference
+    uint32_t mpptHarvestedMwh;
+};
+
+int webTelemetryJson(const TelemetrySnapshot& t, const WebExtras& x, char* out, size_t len);
+// only the fields that differ from `last`; returns 0 when nothing changed
+int webDeltaJson(const TelemetrySnapshot& t, const WebExtras& x, const TelemetrySnapshot& last, const WebExtras& lastX,
+                 char* out, size_t len);
+
+#endif
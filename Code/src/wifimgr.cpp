@@ -0,0 +1,180 @@
+#include "wifimgr.h"
+#include "config.h"
+#include "power.h"
+#include "settings.h"
+#include "journal.h"
+#include "statuslog.h"
+#include "web.h"
+#include "telemstream.h"
+#include <WiFi.h>
+#include <ArduinoOTA.h>
+
+WifiStats wifiStats;
+
+volatile int requestedMode = -1;
+int appliedMode = -1;
+bool servicesStarted = false;
+
+// Counted by the driver's event task, consumed by wifiService()
+volatile uint32_t ipEvents = 0;
+volatile uint32_t dropEvents = 0;
+volatile uint8_t dropReason = 0;
+uint32_t ipSeen = 0;
+uint32_t dropSeen = 0;
+
+uint32_t attemptAtMs = 0;
+uint32_t rssiPolledMs = 0;
+
+static void onWifiEvent(WiFiEvent_t event, WiFiEventInfo_t info) {
+    if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP) {
+        ipEvents = ipEvents + 1;
+    } else if (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED) {
+        dropReason = info.wifi_sta_disconnected.reason;
+        dropEvents = dropEvents + 1;
+    }
+}
+
+void wifiRequest(int mode) {
+    requestedMode = mode;
+}
+
+bool wifiUp() {
+    return wifiStats.state == NET_CONNECTED || wifiStats.state == NET_AP || wifiStats.fallbackAp;
+}
+
+const char* wifiStateName() {
+    static const char* names[] = {"OFF", "CONNECTING", "ONLINE", "RETRY", "AP"};
+    return names[wifiStats.state];
+}
+
+// Everything that listens on the network, set up the first time a mode
+// brings the stack up. The sockets stay bound across mode changes.
+static void startServices() {
+    if (servicesStarted) return;
+    servicesStarted = true;
+
+    // an update in progress counts as activity, so the CPU stays at full speed
+    ArduinoOTA.onStart([]() { powerNoteActivity(); });
+    ArduinoOTA.onProgress([](unsigned int done, unsigned int total) { powerNoteActivity(); });
+    ArduinoOTA.onEnd([]() { settingsFlush(); journalFlush(); }); // ArduinoOTA restarts right after
+    ArduinoOTA.begin();
+    webStart();
+    streamUdpBegin();
+}
+
+static void startAttempt(uint32_t now) {
+    WiFi.begin(wifi_sta_ssid, wifi_sta_pass); // returns at once, the result arrives as an event
+    attemptAtMs = now;
+    wifiStats.state = NET_CONNECTING;
+}
+
+static void scheduleRetry(uint32_t now) {
+    WiFi.disconnect(); // abandon a pending attempt, keep the radio on
+    uint32_t backoff = WIFI_BACKOFF_MIN_MS << min((int)wifiStats.attempts, 6);
+    backoff = min(backoff, (uint32_t)WIFI_BACKOFF_MAX_MS);
+    // jitter so several units behind one AP do not retry in step
+    wifiStats.retryAtMs = now + backoff + random(backoff / 4 + 1);
+    wifiStats.state = NET_BACKOFF;
+}
+
+static void startFallback() {
+    WiFi.mode(WIFI_AP_STA);
+    WiFi.softAP(wifi_ap_ssid, wifi_ap_pass);
+    wifiStats.fallbackAp = true;
+    logEvent(LOG_WARN, EV_WIFI_FALLBACK, wifiStats.attempts);
+}
+
+static void stopFallback() {
+    WiFi.softAPdisconnect(true); // back to STA only
+    wifiStats.fallbackAp = false;
+}
+
+static void applyMode(int mode, uint32_t now) {
+    WiFi.persistent(false);
+    WiFi.setAutoReconnect(false); // retries are paced here instead
+    if (appliedMode < 0) WiFi.onEvent(onWifiEvent);
+
+    // the radio is already off at boot, only tear down a running mode
+    if (appliedMode > 0) WiFi.disconnect(true);
+    appliedMode = mode;
+    wifiStats.fallbackAp = false;
+    wifiStats.attempts = 0;
+    ipSeen = ipEvents;
+    dropSeen = dropEvents;
+
+    if (mode == 1) {
+        WiFi.mode(WIFI_STA);
+        WiFi.setSleep(true); // modem sleep between DTIM beacons
+        startServices();
+        startAttempt(now);
+    } else if (mode == 2) {
+        WiFi.mode(WIFI_AP);
+        WiFi.softAP(wifi_ap_ssid, wifi_ap_pass);
+        startServices();
+        wifiStats.state = NET_AP;
+    } else {
+        WiFi.mode(WIFI_OFF);
+        wifiStats.state = NET_OFF;
+    }
+}
+
+static void onConnected(uint32_t now) {
+    wifiStats.state = NET_CONNECTED;
+    wifiStats.attempts = 0;
+    wifiStats.connects++;
+    wifiStats.connectedAtMs = now;
+    wifiStats.rssi = wifiStats.rssiMin = WiFi.RSSI();
+    wifiStats.rssiAvg16 = wifiStats.rssi * 16;
+    rssiPolledMs = now;
+    logEvent(LOG_INFO, EV_WIFI_UP, wifiStats.rssi);
+}
+
+static void sampleRssi(uint32_t now) {
+    rssiPolledMs = now;
+    int8_t rssi = WiFi.RSSI();
+    wifiStats.rssi = rssi;
+    if (rssi < wifiStats.rssiMin) wifiStats.rssiMin = rssi;
+    wifiStats.rssiAvg16 += (rssi * 16 - wifiStats.rssiAvg16) / 8;
+}
+
+void wifiService() {
+    uint32_t now = millis();
+    int want = requestedMode;
+    if (want != appliedMode) applyMode(want, now);
+
+    uint32_t ips = ipEvents, drops = dropEvents;
+    bool dropped = drops != dropSeen;
+    bool linked = ips != ipSeen && WiFi.isConnected();
+    ipSeen = ips;
+    dropSeen = drops;
+    if (dropped) wifiStats.lastReason = dropReason;
+
+    switch (wifiStats.state) {
+        case NET_CONNECTING:
+            if (linked) {
+                onConnected(now);
+            } else if (dropped || now - attemptAtMs > WIFI_CONNECT_TIMEOUT_MS) {
+                if (wifiStats.attempts < 255) wifiStats.attempts++;
+                if (wifiStats.attempts >= WIFI_FALLBACK_ATTEMPTS && !wifiStats.fallbackAp) startFallback();
+                scheduleRetry(now);
+            }
+            break;
+        case NET_CONNECTED:
+            if (dropped && !WiFi.isConnected()) {
+                wifiStats.drops++;
+                logEvent(LOG_WARN, EV_WIFI_DOWN, wifiStats.lastReason, (now - wifiStats.connectedAtMs) / 1000);
+                scheduleRetry(now);
+            } else if (now - rssiPolledMs >= WIFI_RSSI_POLL_MS) {
+                sampleRssi(now);
+            }
+            break;
+        case NET_BACKOFF:
+            if ((int32_t)(now - wifiStats.retryAtMs) >= 0) startAttempt(now);
+            break;
+        default:
+            break;
+    }
+
+    if (wifiStats.fallbackAp && wifiStats.state == NET_CONNECTED && WiFi.softAPgetStationNum() == 0) stopFallback();
+    if (wifiUp()) ArduinoOTA.handle();
+}
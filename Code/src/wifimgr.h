@@ -0,0 +1,51 @@
+#ifndef WIFIMGR_H
+#define WIFIMGR_H
+
+#include <Arduino.h>
+
+// Wi-Fi connection manager. wifiRequest() only records the wanted mode
+// (0 off, 1 STA, 2 AP), so the menu never waits on the radio. wifiService()
+// runs on the network task: it applies the mode and steps the STA state
+// machine on flags set by the driver's event callback.
+// A failed or dropped STA link is retried after a jittered exponential
+// backoff, WIFI_BACKOFF_MIN_MS doubling up to WIFI_BACKOFF_MAX_MS. After
+// WIFI_FALLBACK_ATTEMPTS failures in a row the configured AP is raised
+// alongside STA so the unit stays reachable; it is dropped again once STA is
+// back and no station is using it. RSSI is sampled while connected.
+
+#define WIFI_CONNECT_TIMEOUT_MS 15000
+#define WIFI_BACKOFF_MIN_MS 1000
+#define WIFI_BACKOFF_MAX_MS 60000
+#define WIFI_FALLBACK_ATTEMPTS 4
+#define WIFI_RSSI_POLL_MS 2000
+
+enum NetState {
+    NET_OFF,
+    NET_CONNECTING,
+    NET_CONNECTED,
+    NET_BACKOFF,         // STA down, waiting for the next attempt
+    NET_AP               // AP mode as configured
+};
+
+struct WifiStats {
+    uint8_t state;          // NetState
+    bool fallbackAp;        // AP raised because STA keeps failing
+    uint8_t attempts;       // failed STA attempts since the last link
+    uint8_t lastReason;     // driver's reason for the last disconnect
+    int8_t rssi;            // dBm, last sample
+    int8_t rssiMin;         // worst sample on the current link
+    int32_t rssiAvg16;      // dBm x16, 1/8 moving average
+    uint32_t connects;
+    uint32_t drops;         // established links lost
+    uint32_t connectedAtMs;
+    uint32_t retryAtMs;     // NET_BACKOFF: when the next attempt starts
+};
+
+extern WifiStats wifiStats;
+
+void wifiRequest(int mode);
+void wifiService();
+bool wifiUp();
+const char* wifiStateName();
+
+#endif
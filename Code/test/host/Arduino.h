@@ -0,0 +1,16 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// Just enough of Arduino.h for the hardware-free modules under the native
+// test environment (pio test -e native).
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+template <typename T> T min(T a, T b) { return a < b ? a : b; }
+template <typename T> T max(T a, T b) { return a > b ? a : b; }
+template <typename T> T constrain(T v, T lo, T hi) { return v < lo ? lo : (v > hi ? hi : v); }
+
+#endif
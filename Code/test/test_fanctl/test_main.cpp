@@ -0,0 +1,122 @@
+// Fan control against a lumped thermal model of the battery zone.
+//   pio test -e native -f test_fanctl
+
+#include <unity.h>
+#include "fanctl.h"
+
+static const FanZoneConfig BAT = {4000, 5000, 400000}; // default TBAT band, 40-50 C
+
+// One thermal mass cooled to ambient through a conductance that grows with
+// fan duty, read by a DS18B20 with a thermal lag, 0.125 C steps (11 bit) and
+// a new conversion every READ_MS, run by the 100 ms control task.
+struct ThermalModel {
+    double tempC;
+    double sensorC;        // probe temperature, lags the pack
+    double heatW;
+    double ambientC = 30.0;
+    double massJperK = 600.0;
+    double stillWperK = 1.0;
+    double fanWperK = 3.0; // extra at full duty
+    double probeLagS = 20.0;
+};
+
+static const uint32_t TICK_MS = 100;
+static const uint32_t READ_MS = 750;
+
+struct Run {
+    int32_t demandMin, demandMax;  // over the measurement window
+    double tempMax;
+};
+
+static int32_t quantise(double c) {
+    return (int32_t)(c * 8 + (c >= 0 ? 0.5 : -0.5)) * 100 / 8;
+}
+
+// same composition as handleFanControl: zone demand, slew limit, duty
+static Run simulate(ThermalModel m, uint32_t settleMs, uint32_t measureMs) {
+    FanZone zone = {};
+    int32_t demand = 0;
+    int32_t reading = quantise(m.sensorC);
+    uint32_t readAt = 0;
+    Run r = {1000, 0, m.tempC};
+
+    for (uint32_t now = TICK_MS; now <= settleMs + measureMs; now += TICK_MS) {
+        if (now - readAt >= READ_MS) {
+            reading = quantise(m.sensorC);
+            readAt = now;
+        }
+        int32_t target = fanZoneUpdate(zone, BAT, reading, readAt, false, (int32_t)(m.heatW * 4000), TICK_MS);
+        demand = (target >= 1000) ? target : fanSlew(demand, target, TICK_MS);
+        double duty = fanDutyPermille(demand, 50) / 1000.0;
+
+        double dt = TICK_MS / 1000.0;
+        double g = m.stillWperK + m.fanWperK * duty;
+        m.tempC += (m.heatW - (m.tempC - m.ambientC) * g) / m.massJperK * dt;
+        m.sensorC += (m.tempC - m.sensorC) / m.probeLagS * dt;
+
+        if (m.tempC > r.tempMax) r.tempMax = m.tempC;
+        if (now > settleMs) {
+            r.demandMin = min(r.demandMin, demand);
+            r.demandMax = max(r.demandMax, demand);
+        }
+    }
+    return r;
+}
+
+void setUp() {}
+void tearDown() {}
+
+// Steady heat that needs part-speed cooling: the fan must settle, not hunt
+// between quantisation steps.
+void test_steady_load_settles() {
+    ThermalModel m;
+    m.tempC = m.sensorC = 38.0;
+    m.heatW = 25.0;
+    Run r = simulate(m, 30 * 60000UL, 10 * 60000UL);
+    TEST_ASSERT_LESS_THAN(5000 / 100.0, r.tempMax);
+    TEST_ASSERT_LESS_THAN_INT32(100, r.demandMax - r.demandMin);
+}
+
+// More heat than still air can shed even at the top of the band
+void test_heavy_load_stays_below_max() {
+    ThermalModel m;
+    m.tempC = m.sensorC = 35.0;
+    m.heatW = 45.0;
+    Run r = simulate(m, 40 * 60000UL, 0);
+    TEST_ASSERT_LESS_THAN(50.0, r.tempMax);
+}
+
+// A single 0.125 C step at a new reading must not kick the output
+void test_single_step_is_not_a_kick() {
+    FanZone z = {};
+    uint32_t now = 0;
+    int32_t before = 0;
+    for (int i = 0; i < 200; i++) {
+        now += TICK_MS;
+        before = fanZoneUpdate(z, BAT, 4500, (now / READ_MS) * READ_MS, false, 0, TICK_MS);
+    }
+    now += TICK_MS;
+    int32_t after = fanZoneUpdate(z, BAT, 4512, now, false, 0, TICK_MS);
+    // proportional part of one step is 12 permille; allow a little derivative on top
+    TEST_ASSERT_LESS_THAN_INT32(40, after - before);
+}
+
+// Between conversions the rate holds its value instead of dropping to 0
+void test_rate_only_moves_on_new_readings() {
+    FanZone z = {};
+    fanZoneUpdate(z, BAT, 4500, 0, false, 0, TICK_MS);
+    fanZoneUpdate(z, BAT, 4550, 750, false, 0, TICK_MS);
+    int32_t rate = z.rateC100s;
+    TEST_ASSERT_GREATER_THAN(0, rate);
+    for (int i = 0; i < 5; i++) fanZoneUpdate(z, BAT, 4550, 750, false, 0, TICK_MS);
+    TEST_ASSERT_EQUAL_INT32(rate, z.rateC100s);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_steady_load_settles);
+    RUN_TEST(test_heavy_load_stays_below_max);
+    RUN_TEST(test_single_step_is_not_a_kick);
+    RUN_TEST(test_rate_only_moves_on_new_readings);
+    return UNITY_END();
+}
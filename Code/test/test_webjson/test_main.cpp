@@ -0,0 +1,78 @@
+// Web JSON encoders on the host.
+//   pio test -e native -f test_webjson
+
+#include <unity.h>
+#include "webjson.h"
+
+static TelemetrySnapshot snapshot() {
+    TelemetrySnapshot t = {};
+    t.vbat_mv = 15200;
+    t.ibat_ma = -1250;
+    t.pbat_mw = -19000;
+    t.vcel_mv = 3800;
+    t.soc_permille = 640;
+    t.tteMin = 185;
+    t.vbus_mv = 20000;
+    t.ibus_ma = 0;
+    for (int i = 0; i < 4; i++) t.tempCenti[i] = 2500 + i * 100;
+    return t;
+}
+
+static const WebExtras EXTRAS = {35, 962, 12500};
+
+void setUp() {}
+void tearDown() {}
+
+void test_full_snapshot() {
+    char out[WEB_JSON_MAX];
+    TelemetrySnapshot t = snapshot();
+    t.tempStale[2] = true;
+    int n = webTelemetryJson(t, EXTRAS, out, sizeof(out));
+    TEST_ASSERT_EQUAL_STRING("{\"vbat\":15200,\"ibat\":-1250,\"pbat\":-19000,\"vcel\":3800,\"soc\":640,"
+                             "\"vbus\":20000,\"ibus\":0,\"pbus\":0,\"t0\":2500,\"t1\":2600,\"t2\":null,\"t3\":2800,"
+                             "\"fan\":35,\"tte\":185,\"mppt_eff\":962,\"mppt_wh\":12500}", out);
+    TEST_ASSERT_EQUAL(strlen(out), n);
+}
+
+void test_unknowns_are_null() {
+    char out[WEB_JSON_MAX];
+    TelemetrySnapshot t = snapshot();
+    t.tteMin = -1;
+    WebExtras x = EXTRAS;
+    x.mpptEffPermille = -1;
+    webTelemetryJson(t, x, out, sizeof(out));
+    TEST_ASSERT_NOT_NULL(strstr(out, "\"tte\":null"));
+    TEST_ASSERT_NOT_NULL(strstr(out, "\"mppt_eff\":null"));
+}
+
+void test_delta_only_changed_fields() {
+    char out[WEB_JSON_MAX];
+    TelemetrySnapshot last = snapshot();
+    TelemetrySnapshot t = last;
+    TEST_ASSERT_EQUAL(0, webDeltaJson(t, EXTRAS, last, EXTRAS, out, sizeof(out)));
+
+    t.vbat_mv = 15190;
+    t.tempStale[1] = true;
+    WebExtras x = EXTRAS;
+    x.fanPercent = 40;
+    webDeltaJson(t, x, last, EXTRAS, out, sizeof(out));
+    TEST_ASSERT_EQUAL_STRING("{\"vbat\":15190,\"t1\":null,\"fan\":40}", out);
+}
+
+// a short buffer truncates but always stays terminated
+void test_short_buffer() {
+    char out[24];
+    memset(out, 'x', sizeof(out));
+    int n = webTelemetryJson(snapshot(), EXTRAS, out, sizeof(out));
+    TEST_ASSERT_LESS_THAN(sizeof(out), n);
+    TEST_ASSERT_EQUAL('\0', out[n]);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_full_snapshot);
+    RUN_TEST(test_unknowns_are_null);
+    RUN_TEST(test_delta_only_changed_fields);
+    RUN_TEST(test_short_buffer);
+    return UNITY_END();
+}
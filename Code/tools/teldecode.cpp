@@ -0,0 +1,341 @@
+// Host-side decoder for the binary telemetry stream (src/telemframe.h).
+//
+//   g++ -std=c++11 -O2 -I../src -o teldecode teldecode.cpp
+//
+//   teldecode [-o out.csv] [-c dir] [-n frames] source
+//     source   serial device or pty: switched to raw mode, sent 'b' to start
+//              the stream and 'B' on exit
+//              udp:HOST[:PORT]  subscribes to the device, renewing the lease
+//              a capture file, or - for stdin
+//     -o       CSV output, default stdout
+//     -c       also write columns: one raw little-endian array per field in
+//              dir, named <field>.<type>, plus schema.txt with the row count
+//     -n       stop after this many good frames
+//
+// Frames are found by their sync bytes and kept only if the CRC matches, so
+// text the firmware prints on the same console is skipped. Timestamps are
+// unwrapped to 64 bits. Statistics go to stderr at the end.
+// Assumes a little-endian host, as the device is.
+
+#include "telemframe.h"
+#include "crc32.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void onSignal(int) {
+    stopRequested = 1;
+}
+
+struct DecodeStats {
+    unsigned long frames = 0;
+    unsigned long records = 0;
+    unsigned long crcErrors = 0;
+    unsigned long bytesSkipped = 0;
+    unsigned long framesMissed = 0;   // from sequence gaps
+    unsigned long samplesLost = 0;    // reported by the device
+};
+
+// Accumulates bytes and hands out every frame that checks out
+class FrameParser {
+public:
+    DecodeStats stats;
+
+    template <typename OnRecord>
+    void feed(const uint8_t* data, size_t len, OnRecord onRecord) {
+        buf.insert(buf.end(), data, data + len);
+        size_t pos = 0;
+        while (buf.size() - pos >= sizeof(TelemFrameHeader)) {
+            const uint8_t* p = &buf[pos];
+            if (p[0] != TELEM_SYNC0 || p[1] != TELEM_SYNC1) {
+                pos++;
+                stats.bytesSkipped++;
+                continue;
+            }
+            TelemFrameHeader h;
+            memcpy(&h, p, sizeof(h));
+            if (h.version != TELEM_VERSION || h.recordSize < sizeof(TelemRecord) ||
+                h.count == 0 || h.count > TELEM_MAX_RECORDS) {
+                pos++;
+                stats.bytesSkipped++;
+                continue;
+            }
+            size_t len = sizeof(h) + (size_t)h.count * h.recordSize;
+            if (buf.size() - pos < len + sizeof(uint32_t)) break; // rest not here yet
+            uint32_t crc;
+            memcpy(&crc, p + len, sizeof(crc));
+            if (crc != crc32(p, len)) {
+                pos++;
+                stats.crcErrors++;
+                stats.bytesSkipped++;
+                continue;
+            }
+
+            if (haveSeq) stats.framesMissed += (uint16_t)(h.seq - lastSeq - 1);
+            haveSeq = true;
+            lastSeq = h.seq;
+            stats.frames++;
+            stats.samplesLost += h.lost;
+            for (int i = 0; i < h.count; i++) {
+                TelemRecord r; // a newer firmware's extra fields are ignored
+                memcpy(&r, p + sizeof(h) + (size_t)i * h.recordSize, sizeof(r));
+                onRecord(r);
+                stats.records++;
+            }
+            pos += len + sizeof(uint32_t);
+        }
+        buf.erase(buf.begin(), buf.begin() + pos);
+    }
+
+private:
+    std::vector<uint8_t> buf;
+    bool haveSeq = false;
+    uint16_t lastSeq = 0;
+};
+
+struct Row {
+    int64_t timeUs;
+    TelemRecord r;
+};
+
+static const char* const CSV_HEADER =
+    "time_us,vbat_mv,ibat_ma,vbus_mv,ibus_ma,t0_c100,t1_c100,t2_c100,t3_c100,soc_permille,fan_pct,status\n";
+
+static void writeCsv(FILE* f, const Row& row) {
+    const TelemRecord& r = row.r;
+    fprintf(f, "%lld,%u,%d,%u,%d,%d,%d,%d,%d,%u,%u,0x%04x\n", (long long)row.timeUs, r.vbatMv, r.ibatMa,
+            r.vbusMv, r.ibusMa, r.tempCenti[0], r.tempCenti[1], r.tempCenti[2], r.tempCenti[3],
+            r.socPermille, r.fanPercent, r.status);
+}
+
+// One file per field, each a plain array that numpy.fromfile or similar reads
+// directly. stdio buffers the appends.
+class ColumnWriter {
+public:
+    bool open(const std::string& dir) {
+        this->dir = dir;
+        mkdir(dir.c_str(), 0755);
+        static const char* names[COLUMNS][2] = {
+            {"time_us", "i64"}, {"vbat_mv", "u16"}, {"ibat_ma", "i16"}, {"vbus_mv", "u16"},
+            {"ibus_ma", "i16"}, {"t0_c100", "i16"}, {"t1_c100", "i16"}, {"t2_c100", "i16"},
+            {"t3_c100", "i16"}, {"soc_permille", "u16"}, {"fan_pct", "u8"}, {"status", "u16"}};
+        for (int i = 0; i < COLUMNS; i++) {
+            name[i] = names[i][0];
+            type[i] = names[i][1];
+            std::string path = dir + "/" + name[i] + "." + type[i];
+            files[i] = fopen(path.c_str(), "wb");
+            if (!files[i]) {
+                perror(path.c_str());
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void write(const Row& row) {
+        const TelemRecord& r = row.r;
+        put(0, &row.timeUs, 8);
+        put(1, &r.vbatMv, 2);
+        put(2, &r.ibatMa, 2);
+        put(3, &r.vbusMv, 2);
+        put(4, &r.ibusMa, 2);
+        for (int t = 0; t < 4; t++) put(5 + t, &r.tempCenti[t], 2);
+        put(9, &r.socPermille, 2);
+        put(10, &r.fanPercent, 1);
+        put(11, &r.status, 2);
+        rows++;
+    }
+
+    void close() {
+        for (int i = 0; i < COLUMNS; i++) {
+            if (files[i]) fclose(files[i]);
+            files[i] = nullptr;
+        }
+        FILE* schema = fopen((dir + "/schema.txt").c_str(), "w");
+        if (!schema) return;
+        fprintf(schema, "rows %lu\n", rows);
+        for (int i = 0; i < COLUMNS; i++) fprintf(schema, "%s %s\n", name[i], type[i]);
+        fclose(schema);
+    }
+
+private:
+    static const int COLUMNS = 12;
+    std::string dir;
+    const char* name[COLUMNS] = {};
+    const char* type[COLUMNS] = {};
+    FILE* files[COLUMNS] = {};
+    unsigned long rows = 0;
+
+    void put(int i, const void* v, size_t n) {
+        fwrite(v, n, 1, files[i]);
+    }
+};
+
+static int openUdp(const char* spec) {
+    std::string host = spec;
+    std::string port = "5760";
+    size_t colon = host.rfind(':');
+    if (colon != std::string::npos) {
+        port = host.substr(colon + 1);
+        host = host.substr(0, colon);
+    }
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    addrinfo* res;
+    int err = getaddrinfo(host.c_str(), port.c_str(), &hints, &res);
+    if (err) {
+        fprintf(stderr, "%s: %s\n", spec, gai_strerror(err));
+        return -1;
+    }
+    int fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    // connected, so only the device's datagrams are received
+    if (fd < 0 || connect(fd, res->ai_addr, res->ai_addrlen) < 0) {
+        perror(spec);
+        if (fd >= 0) close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+    return fd;
+}
+
+static bool makeRaw(int fd) {
+    termios tio;
+    if (tcgetattr(fd, &tio) < 0) return false;
+    cfmakeraw(&tio);
+    cfsetispeed(&tio, B115200);
+    cfsetospeed(&tio, B115200);
+    return tcsetattr(fd, TCSANOW, &tio) == 0;
+}
+
+static double nowSec() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void usage() {
+    fprintf(stderr, "usage: teldecode [-o out.csv] [-c dir] [-n frames] <tty | file | - | udp:HOST[:PORT]>\n");
+}
+
+int main(int argc, char** argv) {
+    const char* csvPath = nullptr;
+    const char* columnDir = nullptr;
+    unsigned long maxFrames = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "o:c:n:h")) != -1) {
+        switch (opt) {
+            case 'o': csvPath = optarg; break;
+            case 'c': columnDir = optarg; break;
+            case 'n': maxFrames = strtoul(optarg, nullptr, 10); break;
+            default: usage(); return 2;
+        }
+    }
+    if (optind != argc - 1) {
+        usage();
+        return 2;
+    }
+    const char* source = argv[optind];
+
+    bool udp = strncmp(source, "udp:", 4) == 0;
+    bool tty = false;
+    int fd;
+    if (udp) {
+        fd = openUdp(source + 4);
+    } else if (strcmp(source, "-") == 0) {
+        fd = STDIN_FILENO;
+    } else {
+        fd = open(source, O_RDWR | O_NOCTTY);
+        if (fd < 0) fd = open(source, O_RDONLY);
+        if (fd < 0) perror(source);
+    }
+    if (fd < 0) return 1;
+    if (!udp && isatty(fd)) {
+        tty = makeRaw(fd);
+        if (!tty) perror("raw mode");
+    }
+
+    FILE* csv = stdout;
+    if (csvPath) {
+        csv = fopen(csvPath, "w");
+        if (!csv) {
+            perror(csvPath);
+            return 1;
+        }
+    }
+    ColumnWriter columns;
+    if (columnDir && !columns.open(columnDir)) return 1;
+
+    struct sigaction sa = {};
+    sa.sa_handler = onSignal; // no SA_RESTART: poll() returns on Ctrl-C
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+
+    fputs(CSV_HEADER, csv);
+    if (tty && write(fd, "b", 1) != 1) perror("start stream");
+
+    FrameParser parser;
+    bool haveTime = false;
+    uint32_t lastUs = 0;
+    int64_t timeUs = 0;
+    auto onRecord = [&](const TelemRecord& r) {
+        if (haveTime) timeUs += (uint32_t)(r.timeUs - lastUs);
+        else timeUs = r.timeUs;
+        haveTime = true;
+        lastUs = r.timeUs;
+        Row row = {timeUs, r};
+        writeCsv(csv, row);
+        if (columnDir) columns.write(row);
+    };
+
+    double lastHello = 0;
+    uint8_t chunk[4096];
+    while (!stopRequested && (maxFrames == 0 || parser.stats.frames < maxFrames)) {
+        // renew well inside the device's lease
+        if (udp && nowSec() - lastHello >= 2.0) {
+            if (send(fd, "hello", 5, 0) < 0 && errno != ECONNREFUSED) perror("subscribe");
+            lastHello = nowSec();
+        }
+        pollfd pfd = {fd, POLLIN, 0};
+        int ready = poll(&pfd, 1, 500);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            perror("poll");
+            break;
+        }
+        if (ready == 0) continue;
+        ssize_t n = read(fd, chunk, sizeof(chunk));
+        if (n < 0 && (errno == EINTR || errno == EAGAIN || (udp && errno == ECONNREFUSED))) continue;
+        if (n <= 0) break; // end of file, or the other end of the pty went away
+        parser.feed(chunk, (size_t)n, onRecord);
+    }
+
+    if (tty && write(fd, "B", 1) != 1) perror("stop stream");
+    if (fd != STDIN_FILENO) close(fd);
+    if (csv != stdout) fclose(csv);
+    else fflush(stdout);
+    if (columnDir) columns.close();
+
+    const DecodeStats& s = parser.stats;
+    fprintf(stderr, "%lu frames, %lu records, %lu CRC errors, %lu bytes skipped, %lu frames missed, "
+            "%lu samples lost on the device\n", s.frames, s.records, s.crcErrors, s.bytesSkipped,
+            s.framesMissed, s.samplesLost);
+    return 0;
+}